@@ -33,6 +33,11 @@
 #include <string.h>
 #include <signal.h>
 #include <time.h>
+#include <pthread.h>
+#include <fnmatch.h>
+#include <math.h>
+#include <fcntl.h>
+#include <sys/mman.h>
 
 #define WHITESPACE " \t\n"      // We want to split our command line up into tokens
                                 // so we need to define what delimits our tokens.
@@ -41,9 +46,12 @@
 
 #define MAX_COMMAND_SIZE 255    // The maximum command-line size
 
-#define MAX_NUM_ARGUMENTS 5     // Mav shell only supports five arguments
+#define MAX_NUM_ARGUMENTS 16    // Mav shell only supports sixteen arguments
 
-#define BLOCK_NUM 4226          // Number of blocks available in file system
+#define BLOCK_NUM 4226          // Number of blocks of a newly created file system
+
+#define MAX_BLOCK_NUM 8192      // Number of blocks a file system can be resized to, bounded
+                                // by the free block map and share counts taking one block each
 
 #define BLOCK_SIZE 8192         //Number of bytes for each block
 
@@ -56,17 +64,78 @@
 
 #define BLOCK_FOR_A_FILE 1250   //maximum blocks of a file.
 
-uint8_t blocks[BLOCK_NUM][BLOCK_SIZE];  //a 2d dimensional array that creates blocks.
+#define BLOCK_REFS_INDEX 2      //block holding the share count of every data block
+
+#define SNAPSHOT_TABLE_INDEX 3  //block holding the inode share counts and the snapshot table
+
+#define MAX_SNAPSHOT 16         //maximum number of snapshots of the file system
+
+#define MAX_REFS 255            //maximum share count of a block or an inode
+
+#define SNAPSHOT_START_INDEX 100  //index of the first block holding the saved
+                                  //directory of a snapshot.
+
+#define SNAPSHOT_BLOCKS 2       //blocks taken up by the saved directory of one snapshot
+
+#define SUPERBLOCK_INDEX 4      //block holding the magic number and version of the image
+
+#define FREE_BLOCK_LIST_INDEX 5 //block holding the free block list
+
+#define FS_MAGIC "MFS2"         //magic number of an image in the version 2 layout
+
+#define FS_VERSION 2            //version of the on disk layout
+
+#define STREAM_CHUNK_BLOCKS 16  //blocks read from a pipe at a time while streaming a put
+
+#define DIRECT_ALIGN 4096       //alignment of the buffers, offsets and lengths of direct I/O
+
+#define POOL_BUFFERS 4          //number of buffers in the direct I/O buffer pool
+
+#define POOL_BUFFER_SIZE (128 * BLOCK_SIZE)  //bytes moved by one direct read or write
+
+#define ARCHIVE_MAGIC "MFSA"    //magic number of an archive of a whole image
+
+#define ARCHIVE_VERSION 1       //version of the archive format
+
+#define TRACE_MAGIC "MFST"      //magic number of a workload trace
+
+#define TRACE_VERSION 1         //version of the trace format
+
+uint8_t blocks[MAX_BLOCK_NUM][BLOCK_SIZE] __attribute__((aligned(DIRECT_ALIGN)));  //a 2d dimensional array that creates blocks.
+                                        //only the first block_num blocks are used and the pages of
+                                        //the rest are never touched.
+
+int block_num = BLOCK_NUM;              //number of blocks of the opened file system
 
 FILE * file_d = NULL;                   //creating a file pointer
 
 typedef struct Directory_entry          //A structure is created which holds the information for file
-{                                       //such as is the directory valid, name of the file
-	uint8_t valid;                        //time the file is created and inode index of that file.
+{                                       //such as name of the file, time the file is created in seconds
+	char name[FILENAME_LEN];              //since the epoch, a hash of the name, inode index of that file
+	int64_t timestamp;                    //and is the directory valid. The size and attributes are copies
+	uint32_t hash;                        //of the ones in the inode so list and find never have to
+	uint32_t size;                        //look at the inodes. Every entry takes up 64 bytes so a
+	uint32_t inode;                       //whole directory fits in one block.
+	uint8_t valid;
+	uint8_t attributes_h;
+	uint8_t attributes_r;
+	uint8_t reserved[9];
+}__attribute__((aligned(64))) Directory_Entry;
+
+typedef struct Directory_entry_v1       //A structure which holds the directory entry of the
+{                                       //version 1 layout. It is only used to convert old images.
+	uint8_t valid;
 	char name[FILENAME_LEN];
 	char timestamp[30];
 	uint32_t inode;
-}Directory_Entry;
+}Directory_Entry_v1;
+
+typedef struct Superblock               //A structure which holds the magic number and the version
+{                                       //of the layout of an image.
+	char magic[4];
+	uint32_t version;
+	uint32_t block_count;                 //number of blocks, 0 in images made before resize
+}Superblock;
 
 typedef struct Inode                    //A structure is created which holds the information for inode
 {                                       //for a particular file such as hidden, read only, size of file
@@ -78,13 +147,43 @@ typedef struct Inode                    //A structure is created which holds the
 }Inode;
 
 
+typedef struct Snapshot                 //A structure is created which holds the information for
+{                                       //a snapshot such as is the slot valid, name of the snapshot
+	uint8_t valid;                        //and the time the snapshot was taken. The directory of the
+	char name[FILENAME_LEN];              //snapshot is saved in its own blocks.
+	int64_t timestamp;
+}Snapshot;
+
+typedef struct Snapshot_v1              //A structure which holds a snapshot of the version 1 layout.
+{
+	uint8_t valid;
+	char name[FILENAME_LEN];
+	char timestamp[30];
+}Snapshot_v1;
+
+
 Directory_Entry * dir;                  //A pointer of array to the directory structure
 struct Inode * inodes_list;             //A pointer of array to the  inodes list
 uint8_t * free_block_list;              //a pointer of array to the free blocks
 uint8_t * free_inode_list;              //a pointer of array to the free inodes
+uint8_t * block_refs;                   //a pointer of array to the extra owners of each block
+uint8_t * inode_refs;                   //a pointer of array to the extra owners of each inode
+Snapshot * snapshots;                   //a pointer of array to the snapshot table
+Superblock * superblock;                //a pointer to the superblock
+
+int size_index[NUM_FILE];               //directory indexes of the files sorted by size
+int time_index[NUM_FILE];               //directory indexes of the files sorted by timestamp
+int index_count = 0;                    //number of files in the size and time indexes
 
 time_t timestamp;                       //declaration of time stamp
 
+int batch_mode = 0;                     //set when a single command is run from the command line
+
+uint64_t op_bytes = 0;                  //bytes of file data moved by the running command
+
+int direct_io = 0;                      //set when the image and the files of put and get are
+                                        //read and written with O_DIRECT
+
 
 void FreeINodeList_Init()               //function that initializes the free inode list.
 {
@@ -98,7 +197,7 @@ void FreeINodeList_Init()               //function that initializes the free ino
 void FreeBlockList_Init()               //function that initializes the free block list.
 {
 	int i;
-	for(i =BLOCK_START_INDEX ; i<BLOCK_NUM;i++)   //variable i starts from block_start_index(132) because 
+	for(i =BLOCK_START_INDEX ; i<block_num;i++)   //variable i starts from block_start_index(132) because 
                                                 //all the blocks above that are for directory entry, inodes,
                                                 //free block map and inode map.
 	{
@@ -112,13 +211,18 @@ void Dir_Init()                                 //function that initializes the
 	int i;
 	for(i =0 ; i<128;i++)
 	{
-		dir[i].valid = 0;
-		memset(dir[i].name,0,32);
-		memset(dir[i].timestamp,0,30);
+		memset(&dir[i],0,sizeof(Directory_Entry));
 		dir[i].inode = -1;
 	}
 }
 
+void Superblock_Init()                          //function that marks the image with the magic
+{                                               //number and version of the layout.
+	memcpy(superblock->magic, FS_MAGIC, 4);
+	superblock->version = FS_VERSION;
+	superblock->block_count = block_num;
+}
+
 void Inodes_Init()                              //function that initializes the Inode
                                                 //block for all the files
 {
@@ -136,30 +240,118 @@ void Inodes_Init()                              //function that initializes the
 	}
 }
 
-void initialized()                            //initializing the functions below for the file system.
+/*
+  The size and time indexes hold the directory index of every valid file sorted by
+  size or timestamp, with ties broken by the directory index. They live in memory
+  only, are rebuilt when an image is opened and are kept up to date by every
+  change to a directory entry, so find can walk them instead of the whole directory.
+*/
+
+#define KEY_SIZE 1                            //sort keys of the indexes and of find
+#define KEY_TIME 2
+#define KEY_NAME 3
+
+int64_t entry_key(int filenum, int key)       //this function returns the sort key of a file.
 {
-	Dir_Init();
-	FreeBlockList_Init();
-	FreeINodeList_Init();
+	if(key == KEY_SIZE)
+	{
+		return dir[filenum].size;
+	}
+	return dir[filenum].timestamp;
+}
+
+int index_before(int a, int b, int key)       //this function checks if file a sorts before file b.
+{
+	int64_t key_a = entry_key(a, key);
+	int64_t key_b = entry_key(b, key);
+	return key_a < key_b || (key_a == key_b && a < b);
 }
 
-int disk_size()                               //finding the size occupied by files in the file system.
+void index_remove_from(int* index, int filenum)   //this function removes a file from one index.
 {
-	int size = 0;
-	int i = 0;
-	for(i=0;i<128;i++)
+	int i;
+	for(i = 0; i < index_count; i++)
+	{
+		if(index[i] == filenum)
+		{
+			memmove(&index[i], &index[i + 1], (index_count - i - 1) * sizeof(int));
+			return;
+		}
+	}
+}
+
+void index_insert_into(int* index, int filenum, int key)   //this function adds a file to one index
+{                                                          //at its sorted place.
+	int low = 0;
+	int high = index_count;
+	while(low < high)
 	{
+		int mid = (low + high) / 2;
+		if(index_before(index[mid], filenum, key))
+		{
+			low = mid + 1;
+		}
+		else
+		{
+			high = mid;
+		}
+	}
+	memmove(&index[low + 1], &index[low], (index_count - low) * sizeof(int));
+	index[low] = filenum;
+}
 
-		if(dir[i].valid != 0)                     //if the directory is occupied then the size of file is taken from inode
-                                              //structure and added to the variable size.
+int index_find(int filenum)                   //this function checks if a file is in the indexes.
+{
+	int i;
+	for(i = 0; i < index_count; i++)
+	{
+		if(size_index[i] == filenum)
 		{
-			size += inodes_list[dir[i].inode].size ; 
+			return 1;
 		}
 	}
+	return 0;
+}
+
+void index_remove(int filenum)                //this function removes a file from the indexes.
+{
+	if(index_find(filenum))
+	{
+		index_remove_from(size_index, filenum);
+		index_remove_from(time_index, filenum);
+		index_count--;
+	}
+}
+
+void index_update(int filenum)                //this function moves a file to its new place in the
+{                                             //indexes after its size or timestamp changed.
+	index_remove(filenum);
+	if(dir[filenum].valid != 0)
+	{
+		index_insert_into(size_index, filenum, KEY_SIZE);
+		index_insert_into(time_index, filenum, KEY_TIME);
+		index_count++;
+	}
+}
 
-	return size;
+void index_rebuild()                          //this function builds the indexes from the directory.
+{
+	int i;
+	index_count = 0;
+	for(i = 0; i < NUM_FILE; i++)
+	{
+		index_update(i);
+	}
 }
 
+void initialized()                            //initializing the functions below for the file system.
+{
+	Dir_Init();
+	Superblock_Init();
+	FreeBlockList_Init();
+	FreeINodeList_Init();
+	index_rebuild();
+}
 
 int find_free_dir()                           //this function finds and returns free directory index if valid == 0.
 {
@@ -198,7 +390,7 @@ int find_free_block()                            //this function finds and retur
 {
 	int i;
 	int val =-1;
-	for(i = BLOCK_START_INDEX ; i<BLOCK_NUM;i++)  //variable i starts from block_start_index(132) because 
+	for(i = BLOCK_START_INDEX ; i<block_num;i++)  //variable i starts from block_start_index(132) because 
                                                 //all the blocks above that are for directory entry, inodes,
                                                 //free block map and inode map.
 	{
@@ -212,464 +404,3505 @@ int find_free_block()                            //this function finds and retur
 	return val;
 }
 
-/*create_fs function takes filename as a parameter. If the filename is null then file
-system image won't be created. If the filename is not null, all the memory blocks are
-set to zero. initialized funtion is called to set directory, free blocks and free inodes
-for a file. */
+int file_blocks(uint32_t size)                  //this function returns the number of data blocks
+{                                               //a file of the given size takes up.
+	return (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+}
 
-void create_fs(char* fsname)                  
+int free_block_count()                          //this function counts the free data blocks.
 {
-	if(fsname==NULL) 
+	int i;
+	int count = 0;
+	for(i = BLOCK_START_INDEX ; i<block_num;i++)
 	{
-		printf("mfs> createfs: File not found\n");
-		return;
+		if(free_block_list[i] == 1)
+		{
+			count++;
+		}
 	}
-	memset(blocks, 0 , BLOCK_NUM* BLOCK_SIZE);   
-	file_d = fopen(fsname,"w");
-	initialized();
-	fwrite(blocks, BLOCK_SIZE,BLOCK_NUM,file_d);
-	fclose(file_d);
-	file_d = NULL;
+	return count;
+}
+
+/*
+  A data block or an inode can be owned by more than one file once files are cloned
+  or snapshotted. block_refs and inode_refs count the owners beyond the first one, so
+  a zero count means the block or inode belongs to a single file. Images created
+  before snapshots existed have all counts at zero and stay valid.
+*/
 
+/*block_share function adds an owner to a data block and returns the block that the
+new owner should point at. If the block has too many owners already, the data is
+copied into a free block instead. Returns -1 if no free block is left. */
+int block_share(int block_index)
+{
+	if(block_refs[block_index] < MAX_REFS)
+	{
+		block_refs[block_index]++;
+		return block_index;
+	}
+	int new_index = find_free_block();
+	if(new_index != -1)
+	{
+		memcpy(blocks[new_index], blocks[block_index], BLOCK_SIZE);
+	}
+	return new_index;
 }
 
+/*block_release function drops an owner from a data block. The block goes back to
+the free block list when its last owner lets go of it. */
+void block_release(int block_index)
+{
+	if(block_refs[block_index] > 0)
+	{
+		block_refs[block_index]--;
+	}
+	else
+	{
+		free_block_list[block_index] = 1;
+	}
+}
 
-/*file_searcher function searches for a file in the directory and if the valid is 1
-then it returns the directory index for that file. */
-int file_searcher(char* filename)
+/*inode_release function drops an owner from an inode. When the last owner lets go,
+every data block of the inode is released and the inode is freed. */
+void inode_release(int inode)
 {
 	int i;
-	for(i=0;i<128; i++)
+	if(inode_refs[inode] > 0)
+	{
+		inode_refs[inode]--;
+		return;
+	}
+	for(i = 0; i < file_blocks(inodes_list[inode].size); i++)
+	{
+		block_release(inodes_list[inode].blocks[i]);
+	}
+	inodes_list[inode].attributes_r = 0;
+	inodes_list[inode].attributes_h = 0;
+	inodes_list[inode].size = 0;
+	for(i = 0; i < BLOCK_FOR_A_FILE; i++)
+	{
+		inodes_list[inode].blocks[i] = -1;
+	}
+	free_inode_list[inode] = 1;
+}
+
+/*inode_unshare function gives the file at the directory index its own copy of the
+inode before the inode is changed. The data blocks are not copied, only shared, so
+they get copied later when they are written. Returns -1 if the file system ran out
+of inodes or blocks. */
+int inode_unshare(int filenum)
+{
+	int old_inode = dir[filenum].inode;
+	if(inode_refs[old_inode] == 0)
+	{
+		return 0;
+	}
+	int new_inode = find_free_inode();
+	if(new_inode == -1)
+	{
+		return -1;
+	}
+	memcpy(&inodes_list[new_inode], &inodes_list[old_inode], sizeof(Inode));
+	int i;
+	for(i = 0; i < file_blocks(inodes_list[old_inode].size); i++)
 	{
-		if(dir[i].valid!=0)
+		int block_index = block_share(inodes_list[old_inode].blocks[i]);
+		if(block_index == -1)
 		{
-			if(strcmp(filename,dir[i].name)==0)
+			// undoes the blocks shared so far
+			while(--i >= 0)
 			{
-				return i;
+				block_release(inodes_list[new_inode].blocks[i]);
 			}
+			free_inode_list[new_inode] = 1;
+			return -1;
 		}
+		inodes_list[new_inode].blocks[i] = block_index;
 	}
-	return -1;
+	inode_refs[old_inode]--;
+	dir[filenum].inode = new_inode;
+	return 0;
 }
 
-//open function takes the name of the image of the file in the argument
-//if the name of the file system is null, it returns file is not found.
-//if the name of the file system exists, it reads every data of file_d and
-//copies into 2d array blocks.
-void open(char* fsname) 
+/*name_hash function returns the FNV-1a hash of a file name. The hash is kept in the
+directory entry so a search only compares names when the hashes match. */
+uint32_t name_hash(char* name)
 {
-	file_d = fopen(fsname,"r+");
-	if(file_d==NULL) 
+	uint32_t hash = 2166136261u;
+	int i;
+	for(i = 0; i < FILENAME_LEN && name[i] != '\0'; i++)
 	{
-		printf("mfs> open: File not found\n");
-		return;
+		hash ^= (uint8_t) name[i];
+		hash *= 16777619u;
 	}
-	else
-	{
+	return hash;
+}
 
-	fread(blocks, BLOCK_SIZE,BLOCK_NUM,file_d);
+/*entry_name function stores the name and its hash in a directory entry.*/
+void entry_name(Directory_Entry* entry, char* name)
+{
+	// names of FILENAME_LEN characters are kept without a null at the end
+	memset(entry->name, 0, FILENAME_LEN);
+	memcpy(entry->name, name, strnlen(name, FILENAME_LEN));
+	entry->hash = name_hash(name);
+}
+
+/*entry_sync function copies the size and attributes of the inode of a file into its
+directory entry. It is called every time the inode of a file changes. */
+void entry_sync(int filenum)
+{
+	Inode * inode = &inodes_list[dir[filenum].inode];
+	dir[filenum].size = inode->size;
+	dir[filenum].attributes_h = inode->attributes_h;
+	dir[filenum].attributes_r = inode->attributes_r;
+	index_update(filenum);
 }
+
+/*format_time function writes a timestamp in the form of asctime without the new line.
+Timestamps are kept as numbers and only turned into text to show them. localtime_r
+is used since localtime reloads the time zone on every call. */
+void format_time(int64_t seconds, char* text)
+{
+	time_t t = (time_t) seconds;
+	struct tm tm;
+	localtime_r(&t, &tm);
+	strftime(text, 30, "%a %b %e %H:%M:%S %Y", &tm);
 }
 
+/*create_fs function takes filename as a parameter. If the filename is null then file
+system image won't be created. If the filename is not null, all the memory blocks are
+set to zero. initialized funtion is called to set directory, free blocks and free inodes
+for a file. */
+
 /*
-  fs_close is a void function that  doesn't have any parameters.
-  This function closes any opened file system properly.
-  It basically copies the all the blocks into the file and closes it
+  In direct I/O mode the image and the files moved by put and get are opened with
+  O_DIRECT, so bulk transfers skip the page cache instead of pushing other data
+  out of it. Direct I/O needs aligned buffers, so the transfers go through a small
+  pool of POOL_BUFFER_SIZE buffers that are made once, on hugepages when the host
+  has them, and reused. The blocks array is aligned too, so the image is read and
+  written in place. When a filesystem refuses O_DIRECT the buffered path is used.
 */
-void fs_close( ) 
+typedef struct Buffer_pool
 {
-  if(file_d == NULL)
-  { 
-    // checks if a file system is opeened or not
-    printf("mfs> close error: No open fs to close.\n");
-    return;
+  uint8_t * memory;
+  uint8_t * free_buffers[POOL_BUFFERS];
+  int free_count;
+  int hugepages;                        // set when the pool sits on hugepages
+}Buffer_pool;
+
+Buffer_pool pool;
+
+/*pool_get function hands out a free buffer of the pool, making the pool on first
+use. Returns NULL if no buffer is free or no memory could be had. */
+uint8_t * pool_get()
+{
+  int i;
+  if(pool.memory == NULL)
+  {
+    size_t size = (size_t) POOL_BUFFERS * POOL_BUFFER_SIZE;
+    void * memory = mmap(NULL, size, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    pool.hugepages = memory != MAP_FAILED;
+    if(memory == MAP_FAILED && posix_memalign(&memory, DIRECT_ALIGN, size) != 0)
+    {
+      return NULL;
+    }
+    pool.memory = (uint8_t *) memory;
+    for(i = 0; i < POOL_BUFFERS; i++)
+    {
+      pool.free_buffers[i] = pool.memory + (size_t) i * POOL_BUFFER_SIZE;
+    }
+    pool.free_count = POOL_BUFFERS;
   }
-  // rewinds the file pointer to the top of the file.
-  rewind(file_d);
-  // writes all the data from the block array into the opened file
-  fwrite(blocks, BLOCK_SIZE,BLOCK_NUM,file_d);
-  fclose(file_d);
+  if(pool.free_count == 0)
+  {
+    return NULL;
+  }
+  return pool.free_buffers[--pool.free_count];
+}
 
-  // sets the file_d to null to prevent overwriting
-  file_d = NULL;
+/*pool_put function gives a buffer back to the pool.*/
+void pool_put(uint8_t* buffer)
+{
+  pool.free_buffers[pool.free_count++] = buffer;
+}
+
+/*direct_open function opens a file with O_DIRECT. Returns -1 with errno set to
+EINVAL when the filesystem of the file doesn't do direct I/O. */
+int direct_open(char* name, int flags)
+{
+  return open(name, flags | O_DIRECT, 0644);
+}
+
+/*image_open function opens an image for reading and writing, with O_DIRECT in
+direct I/O mode when the filesystem allows it. */
+FILE * image_open(char* fsname)
+{
+  if(direct_io)
+  {
+    int fd = direct_open(fsname, O_RDWR);
+    if(fd != -1)
+    {
+      return fdopen(fd, "r+");
+    }
+    if(errno != EINVAL)
+    {
+      return NULL;
+    }
+  }
+  return fopen(fsname, "r+");
 }
 
+/*image_read function reads an image into the blocks array and returns the number
+of blocks read. The reads are POOL_BUFFER_SIZE long and aligned so they can be
+done straight into the array with O_DIRECT. */
+int image_read(FILE* fp)
+{
+  int fd = fileno(fp);
+  size_t total = 0;
+  size_t limit = (size_t) MAX_BLOCK_NUM * BLOCK_SIZE;
+  while(total < limit)
+  {
+    size_t length = limit - total < POOL_BUFFER_SIZE ? limit - total : POOL_BUFFER_SIZE;
+    ssize_t bytes = pread(fd, (uint8_t *) blocks + total, length, total);
+    if(bytes <= 0)
+    {
+      break;
+    }
+    total += bytes;
+  }
+  return total / BLOCK_SIZE;
+}
 
 /*
-  put is a void function that accepts one char pointer as parameter.
-  This function copies the file if present from the working directory into
-  the file system. it validates the file and checks the condition for copy
-  and later adds it to the opened file system.
+  put_direct is an int function that copies a file of the working directory into
+  the file system with O_DIRECT reads into a pool buffer. Returns -1 without
+  changing anything if the file can't be opened for direct I/O, so put can go on
+  with the buffered path.
 */
-void put(char* filename)
+int put_direct(char* filename, char* name, uint32_t size)
 {
-  
-  if(strlen(filename)>32)
+  int filenum = find_free_dir();
+  if(filenum == -1)
   {
-    // checks the length of the filename
-    printf("mfs> put error: File name too long.\n");
-    return;
+    printf("mfs> put error: Directory is full.\n");
+    return 0;
   }
-  int status;
-  struct stat buffer;
-  status = stat(filename, &buffer);
-  if(status == -1 )
+  int inode = find_free_inode();
+  if(inode == -1)
   {
-    // checks if file exist or not
-    printf("mfs> put error: File not found.\n");
+    dir[filenum].valid = 0;
+    printf("mfs> put error: Not enough disk space.\n");
+    return 0;
   }
-  /* condition for checking disk min req */
-  else if (buffer.st_size> (BLOCK_SIZE* (BLOCK_NUM-8) - disk_size()))
+  int fd = direct_open(filename, O_RDONLY);
+  uint8_t * buffer = fd != -1 ? pool_get() : NULL;
+  if(buffer == NULL)
   {
-    // checks t h availability of the file system
-    printf("mfs> put error: Not enough disk space.\n");
+    // gives the slot and the inode back for the buffered path
+    if(fd != -1)
+    {
+      close(fd);
+    }
+    dir[filenum].valid = 0;
+    free_inode_list[inode] = 1;
+    return -1;
   }
-  else if (buffer.st_size> BLOCK_FOR_A_FILE*BLOCK_SIZE)
+  int block_count = 0;
+  uint32_t done = 0;
+  int failed = 0;
+  while(done < size && !failed)
   {
-    ///checks the length of the upcoming file
-    printf("mfs> put error: File too big.\n");
+    // the last read asks for a whole buffer and comes back short at the end of the file
+    ssize_t bytes = pread(fd, buffer, POOL_BUFFER_SIZE, done);
+    if(bytes <= 0)
+    {
+      failed = 1;
+      break;
+    }
+    if(bytes > size - done)
+    {
+      bytes = size - done;
+    }
+    ssize_t offset;
+    for(offset = 0; offset < bytes; offset += BLOCK_SIZE)
+    {
+      int block_index = find_free_block();
+      memcpy(blocks[block_index], buffer + offset, bytes - offset < BLOCK_SIZE ? bytes - offset : BLOCK_SIZE);
+      inodes_list[inode].blocks[block_count++] = block_index;
+    }
+    done += bytes;
   }
-  
-  else
-  { 
-     // Open the input file read-only 
-    FILE *ifp = fopen ( filename, "r" ); 
-    // Save off the size of the input file since we'll use it in a couple of places and 
-    // also initialize our index variables to zero. 
-
-    // finds the index of a free dir and free onode
-    int filenum = find_free_dir();
-    dir[filenum].inode = find_free_inode();
-    int copy_size   = buffer.st_size;
-
-    // copies the file name in the dir list
-    strcpy(dir[filenum].name,filename);
-    timestamp = time(NULL);
-
-    // stores the timestamp for the file put in the filesystem.
-    strcpy(dir[filenum].timestamp,asctime( localtime(&timestamp) ));
-    dir[filenum].timestamp[strlen(dir[filenum].timestamp)-1] = '\0';
+  pool_put(buffer);
+  close(fd);
+
+  inodes_list[inode].size = done;
+  inodes_list[inode].attributes_h = 0;
+  inodes_list[inode].attributes_r = 0;
+  dir[filenum].inode = inode;
+  if(failed)
+  {
+    inode_release(inode);
+    dir[filenum].valid = 0;
+    dir[filenum].inode = -1;
+    printf("mfs> An error occured reading from the input file.\n");
+    return 0;
+  }
+  entry_name(&dir[filenum], name);
+  dir[filenum].timestamp = time(NULL);
+  entry_sync(filenum);
+  op_bytes += size;
+  return 0;
+}
 
-    //copys the file size into the inode
-    inodes_list[dir[filenum].inode].size = copy_size;
+/*
+  get_direct is an int function that copies a file of the file system into the
+  working directory with O_DIRECT writes from a pool buffer. A tail that is not a
+  multiple of DIRECT_ALIGN is written after O_DIRECT is turned off. Returns -1 if
+  the file can't be opened for direct I/O, so get can go on with the buffered path.
+*/
+int get_direct(int filenum, char* outname)
+{
+  int fd = direct_open(outname, O_WRONLY | O_CREAT | O_TRUNC);
+  uint8_t * buffer = pool_get();
+  if(fd == -1 || buffer == NULL)
+  {
+    if(fd != -1)
+    {
+      close(fd);
+    }
+    return -1;
+  }
+  Inode * inode = &inodes_list[dir[filenum].inode];
+  uint32_t size = dir[filenum].size;
+  uint32_t done = 0;
+  int block_count = 0;
+  int failed = 0;
+  while(done < size && !failed)
+  {
+    // gathers the blocks of the file into the buffer
+    size_t fill = 0;
+    while(fill < POOL_BUFFER_SIZE && done + fill < size)
+    {
+      size_t num_bytes = size - done - fill < BLOCK_SIZE ? size - done - fill : BLOCK_SIZE;
+      memcpy(buffer + fill, blocks[inode->blocks[block_count++]], num_bytes);
+      fill += num_bytes;
+    }
+    size_t aligned = fill & ~((size_t) DIRECT_ALIGN - 1);
+    if(aligned > 0 && pwrite(fd, buffer, aligned, done) != (ssize_t) aligned)
+    {
+      failed = 1;
+    }
+    if(fill > aligned && !failed)
+    {
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+      failed = pwrite(fd, buffer + aligned, fill - aligned, done + aligned) != (ssize_t)(fill - aligned);
+    }
+    done += fill;
+  }
+  pool_put(buffer);
+  close(fd);
+  if(failed)
+  {
+    printf("mfs> get error: Could not write %s\n", outname);
+    return 0;
+  }
+  op_bytes += size;
+  return 0;
+}
+
+/*
+  direct is a void function that accepts one char pointer as parameter.
+  direct on or direct off picks the I/O mode used from the next open, put and get.
+*/
+void direct(char* mode)
+{
+  if(mode == NULL)
+  {
+    printf("direct I/O is %s.\n", direct_io ? "on" : "off");
+  }
+  else if(strcmp(mode, "on") == 0 || strcmp(mode, "off") == 0)
+  {
+    direct_io = strcmp(mode, "on") == 0;
+  }
+  else
+  {
+    printf("mfs> direct error: Usage: direct on|off\n");
+  }
+}
+
+/*
+  image_write function writes the file system into the image. The metadata blocks
+  and every run of used data blocks are written, while the runs of free data blocks
+  are punched out of the image so the host gives their space back. The image is
+  then cut or grown to the size of the file system. Returns -1 if a write failed.
+*/
+int image_write(FILE* fp)
+{
+	int fd = fileno(fp);
+	int status = 0;
+	int i = BLOCK_START_INDEX;
+	if(pwrite(fd, blocks, (size_t) BLOCK_START_INDEX * BLOCK_SIZE, 0) != BLOCK_START_INDEX * BLOCK_SIZE)
+	{
+		status = -1;
+	}
+	while(i < block_num)
+	{
+		int start = i;
+		uint8_t is_free = free_block_list[i];
+		while(i < block_num && free_block_list[i] == is_free)
+		{
+			i++;
+		}
+		off_t offset = (off_t) start * BLOCK_SIZE;
+		size_t length = (size_t)(i - start) * BLOCK_SIZE;
+		if(is_free)
+		{
+			// filesystems without hole punching just keep the old data of the free blocks
+			fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, length);
+		}
+		else if(pwrite(fd, blocks[start], length, offset) != (ssize_t) length)
+		{
+			status = -1;
+		}
+	}
+	if(ftruncate(fd, (off_t) block_num * BLOCK_SIZE) != 0)
+	{
+		status = -1;
+	}
+	return status;
+}
+
+void create_fs(char* fsname)                  
+{
+	if(fsname==NULL) 
+	{
+		printf("mfs> createfs: File not found\n");
+		return;
+	}
+	block_num = BLOCK_NUM;
+	memset(blocks, 0 , BLOCK_NUM* BLOCK_SIZE);   
+	file_d = fopen(fsname,"w");
+	if(file_d == NULL)
+	{
+		printf("mfs> createfs: Could not create %s\n", fsname);
+		return;
+	}
+	initialized();
+	// the data blocks are all free so the new image is sparse
+	image_write(file_d);
+	fclose(file_d);
+	file_d = NULL;
+
+}
+
+
+/*file_searcher function searches for a file in the directory and if the valid is 1
+then it returns the directory index for that file. Names longer than FILENAME_LEN
+can't be stored, so they never match a stored name that starts the same way. */
+int file_searcher(char* filename)
+{
+	int i;
+	if(strlen(filename) > FILENAME_LEN)
+	{
+		return -1;
+	}
+	uint32_t hash = name_hash(filename);
+	for(i=0;i<128; i++)
+	{
+		if(dir[i].valid!=0 && dir[i].hash == hash)
+		{
+			if(strncmp(filename,dir[i].name,FILENAME_LEN)==0)
+			{
+				return i;
+			}
+		}
+	}
+	return -1;
+}
+
+//fs_open function takes the name of the image of the file in the argument
+//if the name of the file system is null, it returns file is not found.
+//if the name of the file system exists, it reads every data of file_d and
+//copies into 2d array blocks.
+void fs_open(char* fsname) 
+{
+	file_d = image_open(fsname);
+	if(file_d==NULL) 
+	{
+		printf("mfs> open: File not found\n");
+		return;
+	}
+	else
+	{
+
+	int count = image_read(file_d);
+	// images of the old layout have no magic number and need to be converted first
+	if(memcmp(superblock->magic, FS_MAGIC, 4) != 0 || superblock->version != FS_VERSION)
+	{
+		printf("mfs> open: Old image layout, run convert %s first.\n", fsname);
+		fclose(file_d);
+		file_d = NULL;
+		block_num = BLOCK_NUM;
+		initialized();
+		return;
+	}
+	if(superblock->block_count != 0 &&
+		(superblock->block_count <= BLOCK_START_INDEX || superblock->block_count > MAX_BLOCK_NUM))
+	{
+		printf("mfs> open: Bad block count %u in %s.\n", superblock->block_count, fsname);
+		fclose(file_d);
+		file_d = NULL;
+		block_num = BLOCK_NUM;
+		initialized();
+		return;
+	}
+	block_num = superblock->block_count != 0 ? superblock->block_count : BLOCK_NUM;
+	if(count < block_num)
+	{
+		// a short image is read as if the rest of it was a hole
+		memset(blocks[count], 0, (size_t)(block_num - count) * BLOCK_SIZE);
+	}
+	index_rebuild();
+}
+}
+
+/*parse_time function turns a timestamp written by asctime back into seconds since
+the epoch. Returns 0 if the text can't be read. */
+int64_t parse_time(char* text)
+{
+	struct tm tm;
+	memset(&tm, 0, sizeof(tm));
+	if(strptime(text, "%a %b %d %H:%M:%S %Y", &tm) == NULL)
+	{
+		return 0;
+	}
+	tm.tm_isdst = -1;
+	return mktime(&tm);
+}
+
+/*convert_directory function rewrites the directory at the given location from
+the version 1 layout into the version 2 layout. The size and attributes of every
+file are copied from its inode into the new entry. */
+void convert_directory(void* location)
+{
+	Directory_Entry_v1 old[NUM_FILE];
+	char name[FILENAME_LEN + 1];
+	int i;
+	memcpy(old, location, sizeof(old));
+	memset(location, 0, sizeof(old));
+	Directory_Entry * entries = (Directory_Entry *) location;
+	for(i = 0; i < NUM_FILE; i++)
+	{
+		entries[i].inode = -1;
+		if(old[i].valid == 0)
+		{
+			continue;
+		}
+		// names of 32 characters have no null at the end in the old layout
+		memcpy(name, old[i].name, FILENAME_LEN);
+		name[FILENAME_LEN] = '\0';
+		entry_name(&entries[i], name);
+		old[i].timestamp[29] = '\0';
+		entries[i].timestamp = parse_time(old[i].timestamp);
+		entries[i].inode = old[i].inode;
+		entries[i].valid = 1;
+		entries[i].size = inodes_list[old[i].inode].size;
+		entries[i].attributes_h = inodes_list[old[i].inode].attributes_h;
+		entries[i].attributes_r = inodes_list[old[i].inode].attributes_r;
+	}
+}
+
+/*
+  convert is a void function that accepts one char pointer as parameter.
+  This function converts an image of the version 1 layout, with text timestamps
+  and 68 byte directory entries, into the version 2 layout. The live directory,
+  the saved directories of the snapshots and the snapshot table are rewritten,
+  the inodes and data blocks stay where they are.
+*/
+void convert(char* fsname)
+{
+	int i;
+	if(fsname == NULL)
+	{
+		printf("mfs> convert error: Usage: convert <image>\n");
+		return;
+	}
+	if(file_d != NULL)
+	{
+		printf("mfs> convert error: Close the open file system first.\n");
+		return;
+	}
+	file_d = fopen(fsname,"r+");
+	if(file_d == NULL)
+	{
+		printf("mfs> convert error: File not found\n");
+		return;
+	}
+	block_num = BLOCK_NUM;
+	fread(blocks, BLOCK_SIZE,BLOCK_NUM,file_d);
+	if(memcmp(superblock->magic, FS_MAGIC, 4) == 0)
+	{
+		printf("mfs> convert: Image is already in version %d layout.\n", superblock->version);
+	}
+	else
+	{
+		Snapshot_v1 old[MAX_SNAPSHOT];
+		memcpy(old, snapshots, sizeof(old));
+		memset(snapshots, 0, sizeof(old));
+		for(i = 0; i < MAX_SNAPSHOT; i++)
+		{
+			if(old[i].valid != 0)
+			{
+				convert_directory(&blocks[SNAPSHOT_START_INDEX + i * SNAPSHOT_BLOCKS]);
+				snapshots[i].valid = 1;
+				memcpy(snapshots[i].name, old[i].name, FILENAME_LEN);
+				old[i].timestamp[29] = '\0';
+				snapshots[i].timestamp = parse_time(old[i].timestamp);
+			}
+		}
+		convert_directory(dir);
+		Superblock_Init();
+		rewind(file_d);
+		fwrite(blocks, BLOCK_SIZE,BLOCK_NUM,file_d);
+	}
+	fclose(file_d);
+	file_d = NULL;
+	initialized();
+}
+
+/*
+  fs_close is a void function that  doesn't have any parameters.
+  This function closes any opened file system properly.
+  It basically copies the all the blocks into the file and closes it
+*/
+void fs_close( ) 
+{
+  if(file_d == NULL)
+  { 
+    // checks if a file system is opeened or not
+    printf("mfs> close error: No open fs to close.\n");
+    return;
+  }
+  // writes the metadata and the used blocks into the opened file and
+  // gives the space of the free blocks back to the host.
+  if(image_write(file_d) != 0)
+  {
+    printf("mfs> close error: Could not write the image.\n");
+  }
+  fclose(file_d);
+
+  // sets the file_d to null to prevent overwriting
+  file_d = NULL;
+}
+
+
+/*
+  The streaming put reads its input with a reader thread that fills two chunk
+  buffers in turn while the main thread copies the other one into the file system.
+  A buffer is handed over with its full flag, under the stream lock.
+*/
+typedef struct Stream_buffer
+{
+  uint8_t data[STREAM_CHUNK_BLOCKS * BLOCK_SIZE];
+  size_t length;                        // number of bytes read into the buffer
+  int full;                             // set when the buffer waits to be copied
+}Stream_buffer;
+
+typedef struct Stream
+{
+  FILE * ifp;
+  Stream_buffer buffer[2];
+  int error;                            // set when reading the input failed
+  int stop;                             // set when the writer gave up on the input
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+}Stream;
+
+/*stream_reader function is run by the reader thread. It reads the input into the
+empty buffer until the input ends or the writer stops it. */
+void * stream_reader(void * arg)
+{
+  Stream * stream = (Stream *) arg;
+  int i = 0;
+  while(1)
+  {
+    Stream_buffer * buffer = &stream->buffer[i];
+    pthread_mutex_lock(&stream->lock);
+    while(buffer->full && !stream->stop)
+    {
+      pthread_cond_wait(&stream->changed, &stream->lock);
+    }
+    int stop = stream->stop;
+    pthread_mutex_unlock(&stream->lock);
+    if(stop)
+    {
+      break;
+    }
+
+    // the buffer is empty so it is only used by this thread until it is full
+    size_t length = fread(buffer->data, 1, sizeof(buffer->data), stream->ifp);
+
+    pthread_mutex_lock(&stream->lock);
+    buffer->length = length;
+    buffer->full = 1;
+    stream->error = ferror(stream->ifp);
+    pthread_cond_broadcast(&stream->changed);
+    pthread_mutex_unlock(&stream->lock);
+
+    // a short read means the input has ended
+    if(length < sizeof(buffer->data))
+    {
+      break;
+    }
+    i = 1 - i;
+  }
+  return NULL;
+}
+
+/*
+  put_stream is a void function that stores the input of unknown length into the
+  file system under the given name. Blocks are taken as the data comes in and the
+  size of the file is set at the end of the input. If the file system runs out of
+  space, everything taken so far is given back and no file is created.
+*/
+void put_stream(FILE* ifp, char* name)
+{
+  int filenum = find_free_dir();
+  if(filenum == -1)
+  {
+    printf("mfs> put error: Directory is full.\n");
+    return;
+  }
+  int inode = find_free_inode();
+  if(inode == -1)
+  {
+    dir[filenum].valid = 0;
+    printf("mfs> put error: Not enough disk space.\n");
+    return;
+  }
+  Stream * stream = (Stream *) calloc(1, sizeof(Stream));
+  stream->ifp = ifp;
+  pthread_mutex_init(&stream->lock, NULL);
+  pthread_cond_init(&stream->changed, NULL);
+  pthread_t reader;
+  pthread_create(&reader, NULL, stream_reader, stream);
+
+  char * error = NULL;
+  uint32_t size = 0;
+  int block_count = 0;
+  int i = 0;
+  while(error == NULL)
+  {
+    Stream_buffer * buffer = &stream->buffer[i];
+    pthread_mutex_lock(&stream->lock);
+    while(!buffer->full)
+    {
+      pthread_cond_wait(&stream->changed, &stream->lock);
+    }
+    pthread_mutex_unlock(&stream->lock);
+
+    // copies the full buffer into free blocks while the reader fills the other one
+    size_t offset;
+    for(offset = 0; offset < buffer->length; offset += BLOCK_SIZE)
+    {
+      size_t num_bytes = buffer->length - offset;
+      if(num_bytes > BLOCK_SIZE)
+      {
+        num_bytes = BLOCK_SIZE;
+      }
+      if(block_count == BLOCK_FOR_A_FILE)
+      {
+        error = "File too big.";
+        break;
+      }
+      int block_index = find_free_block();
+      if(block_index == -1)
+      {
+        error = "Not enough disk space.";
+        break;
+      }
+      memcpy(blocks[block_index], buffer->data + offset, num_bytes);
+      inodes_list[inode].blocks[block_count] = block_index;
+      block_count++;
+      size += num_bytes;
+    }
+
+    int last = buffer->length < sizeof(buffer->data);
+    pthread_mutex_lock(&stream->lock);
+    if(stream->error)
+    {
+      error = "An error occured reading from the input file.";
+    }
+    buffer->full = 0;
+    if(error != NULL)
+    {
+      stream->stop = 1;
+    }
+    pthread_cond_broadcast(&stream->changed);
+    pthread_mutex_unlock(&stream->lock);
+    if(last)
+    {
+      break;
+    }
+    i = 1 - i;
+  }
+  pthread_join(reader, NULL);
+  pthread_mutex_destroy(&stream->lock);
+  pthread_cond_destroy(&stream->changed);
+  free(stream);
+
+  if(error != NULL)
+  {
+    // rolls back the blocks, the inode and the directory entry
+    for(i = 0; i < block_count; i++)
+    {
+      free_block_list[inodes_list[inode].blocks[i]] = 1;
+      inodes_list[inode].blocks[i] = -1;
+    }
+    free_inode_list[inode] = 1;
+    dir[filenum].valid = 0;
+    printf("mfs> put error: %s\n", error);
+    return;
+  }
+
+  // the size of the file is only known now that the input has ended
+  inodes_list[inode].attributes_h = 0;
+  inodes_list[inode].attributes_r = 0;
+  inodes_list[inode].size = size;
+  dir[filenum].inode = inode;
+  op_bytes += size;
+  entry_name(&dir[filenum], name);
+  dir[filenum].timestamp = time(NULL);
+  entry_sync(filenum);
+}
+
+/*
+  put is a void function that accepts two char pointer as parameter.
+  This function copies the file if present from the working directory into
+  the file system. it validates the file and checks the condition for copy
+  and later adds it to the opened file system. The file is stored under the
+  new file name if one is given. Pipes, devices and "-" for the standard
+  input are streamed in since their size is not known up front.
+*/
+void put(char* filename, char* newfilename)
+{
+  if(filename == NULL)
+  {
+    printf("mfs> put error: Usage: put <file> [new file name]\n");
+    return;
+  }
+  // the file is stored under its own name unless a new name is given
+  char * name = filename;
+  if(newfilename != NULL)
+  {
+    name = newfilename;
+  }
+  if(strlen(name)>32)
+  {
+    // checks the length of the filename
+    printf("mfs> put error: File name too long.\n");
+    return;
+  }
+  if(strcmp(filename, "-") == 0)
+  {
+    // reads the file from the standard input
+    if(!batch_mode)
+    {
+      printf("mfs> put error: Standard input can only be read in batch mode.\n");
+    }
+    else if(newfilename == NULL)
+    {
+      printf("mfs> put error: A file name is needed to read standard input.\n");
+    }
+    else
+    {
+      put_stream(stdin, name);
+    }
+    return;
+  }
+  int status;
+  struct stat buffer;
+  status = stat(filename, &buffer);
+  if(status == -1 )
+  {
+    // checks if file exist or not
+    printf("mfs> put error: File not found.\n");
+  }
+  else if(!S_ISREG(buffer.st_mode))
+  {
+    // pipes and devices have no size up front so they are streamed in
+    FILE *ifp = fopen(filename, "r");
+    if(ifp == NULL)
+    {
+      printf("mfs> put error: File not found.\n");
+      return;
+    }
+    put_stream(ifp, name);
+    fclose(ifp);
+  }
+  /* condition for checking disk min req */
+  else if (buffer.st_size> (off_t) free_block_count() * BLOCK_SIZE)
+  {
+    // checks t h availability of the file system
+    printf("mfs> put error: Not enough disk space.\n");
+  }
+  else if (buffer.st_size> BLOCK_FOR_A_FILE*BLOCK_SIZE)
+  {
+    ///checks the length of the upcoming file
+    printf("mfs> put error: File too big.\n");
+  }
+  
+  else if(direct_io && put_direct(filename, name, buffer.st_size) == 0)
+  {
+    // the file was copied with direct I/O
+  }
+  else
+  { 
+     // Open the input file read-only 
+    FILE *ifp = fopen ( filename, "r" ); 
+    // Save off the size of the input file since we'll use it in a couple of places and 
+    // also initialize our index variables to zero. 
+
+    // finds the index of a free dir and free onode
+    int filenum = find_free_dir();
+    dir[filenum].inode = find_free_inode();
+    if(dir[filenum].inode == -1)
+    {
+      // inodes kept by snapshots can run out before the directory does
+      dir[filenum].valid = 0;
+      fclose(ifp);
+      printf("mfs> put error: Not enough disk space.\n");
+      return;
+    }
+    int copy_size   = buffer.st_size;
+
+    // copies the file name in the dir list
+    entry_name(&dir[filenum],name);
+
+    // stores the timestamp for the file put in the filesystem.
+    dir[filenum].timestamp = time(NULL);
+
+    //copys the file size into the inode and the directory entry
+    inodes_list[dir[filenum].inode].size = copy_size;
+    inodes_list[dir[filenum].inode].attributes_h = 0;
+    inodes_list[dir[filenum].inode].attributes_r = 0;
+    entry_sync(filenum);
+
+    //inodes_list[dir[filenum].inode].attributes = 3;
+
+    int block_count = 0;
+    // We want to copy and write in chunks of BLOCK_SIZE. So to do this 
+    // we are going to use fseek to move along our file stream in chunks of BLOCK_SIZE.
+    // We will copy bytes, increment our file pointer by BLOCK_SIZE and repeat.
+    int offset      = 0;               
+
+    // We are going to copy and store our file in BLOCK_SIZE chunks instead of one big 
+    // memory pool. Why? We are simulating the way the file system stores file data in
+    // blocks of space on the disk. block_index will keep us pointing to the area of
+    // the area that we will read from or write to.
+
+    // copy_size is initialized to the size of the input file so each loop iteration we
+    // will copy BLOCK_SIZE bytes from the file then reduce our copy_size counter by
+    // BLOCK_SIZE number of bytes. When copy_size is less than or equal to zero we know
+    // we have copied all the data from the input file.
+    while( copy_size > 0 )
+    {
+      int block_index = find_free_block();
+      // finds a free block from tbhe free block list
+
+      // stores the index of the data bloc k in the inode
+      inodes_list[dir[filenum].inode].blocks[block_count]= block_index;
+
+
+      // Index into the input file by offset number of bytes.  Initially offset is set to
+      // zero so we copy BLOCK_SIZE number of bytes from the front of the file.  We 
+      // then increase the offset by BLOCK_SIZE and continue the process.  This will
+      // make us copy from offsets 0, BLOCK_SIZE, 2*BLOCK_SIZE, 3*BLOCK_SIZE, etc.
+      fseek( ifp, offset, SEEK_SET );
+
+      // Read BLOCK_SIZE number of bytes from the input file and store them in our
+      // data array. 
+      int bytes  = fread( blocks[block_index], BLOCK_SIZE, 1, ifp );
+
+      // If bytes == 0 and we haven't reached the end of the file then something is 
+      // wrong. If 0 is returned and we also have the EOF flag set then that is OK.
+      // It means we've reached the end of our input file.
+      if( bytes == 0 && !feof( ifp ) )
+      {
+        printf("mfs> An error occured reading from the input file.\n");
+        return;
+      }
+
+      // Clear the EOF file flag.
+      clearerr( ifp );
+
+      // Reduce copy_size by the BLOCK_SIZE bytes.
+      copy_size -= BLOCK_SIZE;
+
+      // Increase the offset into our input file by BLOCK_SIZE.  This will allow
+      // the fseek at the top of the loop to position us to the correct spot.
+      offset    += BLOCK_SIZE;
+
+      // Increment the index into the block array 
+      block_count ++;
+    }
+
+    // We are done copying from the input file so close it out.
+    fclose( ifp );
+    op_bytes += buffer.st_size;
+  }
+  return;
+}
+
+/*
+  list_entries is a void function that accepts a file pointer and one char pointer
+  as parameter. This function prints all the files that are present in the file
+  system along with their timestamp and size into the file pointer. Only the
+  directory is scanned, the size and attributes are read from the entries.
+  It doesn't show hidden files in default but shows hidden file if -h is
+  passed as a parameter.
+*/
+void list_entries(FILE* out, char* data)
+{
+  int i ;
+  int count =0; // counter for number of files in the system.
+  char text[30];
+  // shows the hidden files too if the user has prompted to do so.
+  int show_hidden = data != NULL && (data[1]=='h'||data[1]=='H');
+  // runs through the loop ih the dir list for to check for the files 
+  for(i=0;i<128;i++)
+  {
+    // checks for the validity of the file and for the hidden file
+    if(dir[i].valid != 0 && (dir[i].attributes_h != 1 || show_hidden))
+    {
+      // the timestamp is only turned into text to show it
+      format_time(dir[i].timestamp, text);
+      fprintf(out, "%8d%27s%15.32s\n", dir[i].size, text, dir[i].name);
+      count++;
+    }
+  }
+  // if no files are found in the system shoes no file found.
+  if(count ==0)
+  {
+    fprintf(out, "mfs> list: No files found\n");
+  }
+}
+
+/*
+  list is a void function that accepts one char pointer as parameter.
+  This function lists all the files that are present in the file system.
+*/
+void list(char* data)
+{
+  list_entries(stdout, data);
+}
+
+/*
+  del is a void function that accepts one char pointer as parameter.
+  This function deletes the file if present in the file system. 
+  It can't delete a read only file and throws error if you try to do it.
+*/
+void del(char* filename)
+{
+
+  int filenum = file_searcher(filename);
+  // checks if a file is found or not
+  if(filenum ==-1){
+    printf("mfs> del error: File not found\n");
+    return;
+  }
+  //checks if a file is read only or not
+  if(inodes_list[dir[filenum].inode].attributes_r == 1 )
+  {
+    printf("mfs> del error: That file is marked read-only.\n");
+    return;
+  }
+
+  // drops the file from the inode. if no clone or snapshot shares the inode
+  // the attributes are cleared and the data blocks and the inode are freed
+  // so they can be later used by other files.
+  inode_release(dir[filenum].inode);
+  // makes the dir available for future reuse.
+    dir[filenum].valid = 0;
+    index_remove(filenum);
+    // sets name, timestamp, size and attributes to 0 and removes the inode for m the dir
+    memset(&dir[filenum],0,sizeof(Directory_Entry));
+    dir[filenum].inode = -1;
+}
+
+/*
+  df is a void function that doesn't have any parameters.
+  This function just prints the total free space avaialble in the filesystem.
+*/
+void df()
+{
+  // counts the free blocks since clones share blocks and snapshots keep
+  // blocks of deleted files alive
+  printf("%d bytes free.\n", BLOCK_SIZE * free_block_count() );
+}
+
+/*
+  get is a void function that accepts two char pointer as parameter.
+  This function copies the file if present into the working directory 
+  It also renames the file to a new file name if provided by the user.
+*/
+void get(char* filename, char* newfilename)
+{
+  //checks if a newfile name is provided or not
+  if(newfilename!= NULL)
+
+  {
+    if(strlen(newfilename)>32)
+    {
+      // checks for the length of the file
+      printf("mfs> get error: New file name too long.\n");
+      return;
+    }
+  }
+
+  int block_count = 0;
+  // searches the index of the file that is requested form the file sys.
+  int filenum = file_searcher(filename);
+  if(filenum ==-1){
+    printf("mfs> get error: File not found\n");
+    return;
+  }
+
+  if(direct_io && get_direct(filenum, newfilename != NULL ? newfilename : filename) == 0)
+  {
+    return;
+  }
+
+  FILE *ofp;
+  // if newfilename is given it opens it otherwise it uses the deafult filename 
+  if(newfilename == NULL)
+  {
+    ofp = fopen(filename, "w");
+  }
+  else
+  {
+    ofp = fopen(newfilename, "w");
+  }
+  if( ofp == NULL )
+  {
+    printf("mfs> Could not open output file: %s\n", filename );
+    return ;
+  }
+    // Initialize our offsets and pointers just we did above when reading from the file.
+
+  // assign the copy size of the file
+  int copy_size   = dir[filenum].size;
+  int offset      = 0;
+
+    // Using copy_size as a count to determine when we've copied enough bytes to the output file.
+    // Each time through the loop, except the last time, we will copy BLOCK_SIZE number of bytes from
+    // our stored data to the file fp, then we will increment the offset into the file we are writing to.
+    // On the last iteration of the loop, instead of copying BLOCK_SIZE number of bytes we just copy
+    // how ever much is remaining ( copy_size % BLOCK_SIZE ).  If we just copied BLOCK_SIZE on the
+    // last iteration we'd end up with gibberish at the end of our file. 
+  while( copy_size > 0 )
+  { 
+    int block_index = inodes_list[dir[filenum].inode].blocks[block_count];
+    // reads the specific block from the inode to copy into the file
+    int num_bytes;
+
+      // If the remaining number of bytes we need to copy is less than BLOCK_SIZE then
+      // only copy the amount that remains. If we copied BLOCK_SIZE number of bytes we'd
+      // end up with garbage at the end of the file.
+    if( copy_size < BLOCK_SIZE )
+    {
+      num_bytes = copy_size;
+    }
+    else 
+    {
+      num_bytes = BLOCK_SIZE;
+    }
+
+      // Write num_bytes number of bytes from our data array into our output file.
+    fwrite( blocks[block_index], num_bytes, 1, ofp ); 
+
+      // Reduce the amount of bytes remaining to copy, increase the offset into the file
+      // and increment the block_index to move us to the next data block.
+    copy_size -= BLOCK_SIZE;
+    offset    += BLOCK_SIZE;
+    block_count ++;
+
+      // Since we've copied from the point pointed to by our current file pointer, increment
+      // offset number of bytes so we will be ready to copy to the next area of our output file.
+    fseek( ofp, offset, SEEK_SET );
+  }
+
+    // Close the output file, we're done. 
+  fclose( ofp );
+  op_bytes += dir[filenum].size;
+}
+
+ /* attrib is a void function has two parameters wwhere both of them are char pointer.
+  This function basically sets the asssigned atributes to a requested file if
+  it is present in the file system.
+ */
+void attrib(char* attributes, char* filename)
+{
+  int filenum = file_searcher(filename);
+  if(filenum ==-1){
+    //checks if filename is in the file sys or not
+    printf("mfs> attrib: File not found\n");
+    return;
+  }
+  // the attributes live in the inode, so a clone or a snapshot sharing the
+  // inode must keep its own copy of them.
+  if(inode_unshare(filenum) == -1)
+  {
+    printf("mfs> attrib: Not enough disk space.\n");
+    return;
+  }
+  if(attributes[0] =='+')
+  {
+    // sets the respective attributes according to the user input.
+    if(attributes[1]=='h'|| attributes[1]=='H')
+    {
+      // if +h is typed sets hidden attribute
+      inodes_list[dir[filenum].inode].attributes_h = 1; 
+    }
+    else if(attributes[1]=='r'|| attributes[1]=='R')
+    {
+      // if +r is typed sets read only attribute
+      inodes_list[dir[filenum].inode].attributes_r = 1; 
+    }
+    else
+    {
+      printf("mfs> attrib: Unrecognized attribute.\n"); 
+    }     
+  }
+  else if(attributes[0]=='-')
+  {
+    // sets the respective attributes according to the user input.
+    if(attributes[1]=='h'|| attributes[1]=='H')
+    {
+      // if -h is typed removes hidden attribute
+      inodes_list[dir[filenum].inode].attributes_h = 0; 
+    }
+    else if(attributes[1]=='r'|| attributes[1]=='R')
+    {
+      // if -r is typed removes read only attribute
+      inodes_list[dir[filenum].inode].attributes_r = 0; 
+    }
+    else
+    {
+      printf("mfs> attrib: Unrecognized attribute.\n"); 
+    }
+  }
+  else
+  {
+    printf("mfs> attrib: Unrecognized operation.\n");
+    return;
+  }
+  // keeps the copy of the attributes in the directory entry up to date
+  entry_sync(filenum);
+}
+
+/*parse_offset function reads a non negative number from the user input. It returns
+-1 if the input is missing or not a number. */
+long parse_offset(char* text)
+{
+  if(text == NULL || *text == '\0')
+  {
+    return -1;
+  }
+  char * end;
+  errno = 0;
+  long value = strtol(text, &end, 10);
+  if(*end != '\0' || errno != 0 || value < 0)
+  {
+    return -1;
+  }
+  return value;
+}
+
+/*
+  read_file is a void function that accepts three char pointer as parameter.
+  This function prints length bytes of a file starting at the given offset.
+  Only the blocks holding the asked range are read.
+*/
+void read_file(char* filename, char* offset_str, char* length_str)
+{
+  if(filename == NULL)
+  {
+    printf("mfs> read error: Usage: read <file> <offset> <length>\n");
+    return;
+  }
+  long offset = parse_offset(offset_str);
+  long length = parse_offset(length_str);
+  if(offset == -1 || length == -1)
+  {
+    printf("mfs> read error: Invalid offset or length.\n");
+    return;
+  }
+  int filenum = file_searcher(filename);
+  if(filenum == -1)
+  {
+    printf("mfs> read error: File not found\n");
+    return;
+  }
+  Inode * inode = &inodes_list[dir[filenum].inode];
+  if(offset > inode->size)
+  {
+    printf("mfs> read error: Offset past the end of the file.\n");
+    return;
+  }
+  // reads only up to the end of the file
+  if(length > inode->size - offset)
+  {
+    length = inode->size - offset;
+  }
+  op_bytes += length;
+  while(length > 0)
+  {
+    // maps the byte offset to the block of the inode and the spot inside it
+    int block_offset = offset % BLOCK_SIZE;
+    int num_bytes = BLOCK_SIZE - block_offset;
+    if(num_bytes > length)
+    {
+      num_bytes = length;
+    }
+    fwrite(blocks[inode->blocks[offset / BLOCK_SIZE]] + block_offset, num_bytes, 1, stdout);
+    offset += num_bytes;
+    length -= num_bytes;
+  }
+  fflush(stdout);
+}
+
+/*
+  write_range is an int function that copies length bytes of the opened input
+  file into the file at the directory index starting at the given offset. Only
+  the blocks in the range are touched: blocks shared with a clone or a snapshot
+  are copied before they are written and new blocks are only added at the end
+  of the file. Returns -1 and prints the error if the write can't be done.
+*/
+int write_range(char* op, int filenum, long offset, FILE* ifp, long length)
+{
+  Inode * inode = &inodes_list[dir[filenum].inode];
+  if(inode->attributes_r == 1)
+  {
+    printf("mfs> %s error: That file is marked read-only.\n", op);
+    return -1;
+  }
+  if(offset > inode->size)
+  {
+    printf("mfs> %s error: Offset past the end of the file.\n", op);
+    return -1;
+  }
+  if(offset + length > (long) BLOCK_FOR_A_FILE * BLOCK_SIZE)
+  {
+    printf("mfs> %s error: File too big.\n", op);
+    return -1;
+  }
+  if(length == 0)
+  {
+    return 0;
+  }
+  op_bytes += length;
+
+  // counts the blocks that have to be copied or added before anything is changed,
+  // so running out of space never leaves a half written file.
+  int old_blocks = file_blocks(inode->size);
+  int first = offset / BLOCK_SIZE;
+  int last = (offset + length - 1) / BLOCK_SIZE;
+  int needed = 0;
+  int i;
+  for(i = first; i <= last; i++)
+  {
+    if(i >= old_blocks || block_refs[inode->blocks[i]] > 0 ||
+      inode_refs[dir[filenum].inode] > 0)
+    {
+      needed++;
+    }
+  }
+  if(needed > free_block_count() || inode_unshare(filenum) == -1)
+  {
+    printf("mfs> %s error: Not enough disk space.\n", op);
+    return -1;
+  }
+  inode = &inodes_list[dir[filenum].inode];
+
+  while(length > 0)
+  {
+    int block_count = offset / BLOCK_SIZE;
+    int block_offset = offset % BLOCK_SIZE;
+    int num_bytes = BLOCK_SIZE - block_offset;
+    if(num_bytes > length)
+    {
+      num_bytes = length;
+    }
+
+    if(block_count >= old_blocks || block_refs[inode->blocks[block_count]] > 0)
+    {
+      int block_index = find_free_block();
+      if(block_index == -1)
+      {
+        printf("mfs> %s error: Not enough disk space.\n", op);
+        return -1;
+      }
+      if(block_count >= old_blocks)
+      {
+        // adds a new block at the end of the file
+        memset(blocks[block_index], 0, BLOCK_SIZE);
+      }
+      else
+      {
+        // the block is shared so it gets copied before it is written
+        memcpy(blocks[block_index], blocks[inode->blocks[block_count]], BLOCK_SIZE);
+        block_release(inode->blocks[block_count]);
+      }
+      inode->blocks[block_count] = block_index;
+    }
+
+    if(fread(blocks[inode->blocks[block_count]] + block_offset, num_bytes, 1, ifp) != 1)
+    {
+      printf("mfs> %s error: An error occured reading from the input file.\n", op);
+      return -1;
+    }
+    offset += num_bytes;
+    length -= num_bytes;
+
+    // grows the file as the data goes past its end
+    if(offset > inode->size)
+    {
+      inode->size = offset;
+    }
+  }
+  entry_sync(filenum);
+  return 0;
+}
+
+/*
+  write_file is a void function that accepts four char pointer as parameter.
+  It writes the content of a file from the working directory into a file of the
+  file system starting at the given offset. An offset of NULL appends the data
+  at the end of the file.
+*/
+void write_file(char* op, char* filename, char* offset_str, char* hostfile)
+{
+  if(filename == NULL || hostfile == NULL)
+  {
+    if(strcmp(op, "append") == 0)
+    {
+      printf("mfs> append error: Usage: append <file> <input file>\n");
+    }
+    else
+    {
+      printf("mfs> write error: Usage: write <file> <offset> <input file>\n");
+    }
+    return;
+  }
+  int filenum = file_searcher(filename);
+  if(filenum == -1)
+  {
+    printf("mfs> %s error: File not found\n", op);
+    return;
+  }
+  long offset = inodes_list[dir[filenum].inode].size;
+  if(offset_str != NULL)
+  {
+    offset = parse_offset(offset_str);
+    if(offset == -1)
+    {
+      printf("mfs> %s error: Invalid offset.\n", op);
+      return;
+    }
+  }
+  struct stat buffer;
+  FILE *ifp = NULL;
+  if(stat(hostfile, &buffer) == -1 || (ifp = fopen(hostfile, "r")) == NULL)
+  {
+    printf("mfs> %s error: Input file not found.\n", op);
+    return;
+  }
+  if(write_range(op, filenum, offset, ifp, buffer.st_size) == 0)
+  {
+    dir[filenum].timestamp = time(NULL);
+    index_update(filenum);
+  }
+  fclose(ifp);
+}
+
+/*
+  trim is a void function that doesn't have any parameters.
+  It punches every run of free blocks out of the opened image right away, so the
+  space freed by del shows up on the host without closing the file system. The
+  used blocks and then the metadata are written and synced first, so the image
+  never points at a block that has been punched.
+*/
+void trim()
+{
+  int i = BLOCK_START_INDEX;
+  int fd;
+  if(file_d == NULL)
+  {
+    printf("mfs> trim error: No open fs.\n");
+    return;
+  }
+  fflush(file_d);
+  fd = fileno(file_d);
+  while(i < block_num)
+  {
+    int start = i;
+    while(i < block_num && free_block_list[i] == 0)
+    {
+      i++;
+    }
+    size_t length = (size_t)(i - start) * BLOCK_SIZE;
+    if(length > 0 && pwrite(fd, blocks[start], length, (off_t) start * BLOCK_SIZE) != (ssize_t) length)
+    {
+      printf("mfs> trim error: Can't write the image.\n");
+      return;
+    }
+    while(i < block_num && free_block_list[i] == 1)
+    {
+      i++;
+    }
+  }
+  if(pwrite(fd, blocks, (size_t) BLOCK_START_INDEX * BLOCK_SIZE, 0) != BLOCK_START_INDEX * BLOCK_SIZE ||
+    fdatasync(fd) != 0)
+  {
+    printf("mfs> trim error: Can't write the image.\n");
+    return;
+  }
+  i = BLOCK_START_INDEX;
+  while(i < block_num)
+  {
+    int start = i;
+    while(i < block_num && free_block_list[i] == 1)
+    {
+      i++;
+    }
+    if(i > start && fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+      (off_t) start * BLOCK_SIZE, (off_t)(i - start) * BLOCK_SIZE) != 0)
+    {
+      printf("mfs> trim error: %s\n", strerror(errno));
+      return;
+    }
+    while(i < block_num && free_block_list[i] == 0)
+    {
+      i++;
+    }
+  }
+}
+
+/*
+  resize is a void function that accepts one char pointer as parameter.
+  It changes the number of blocks of the opened file system. Growing adds free
+  blocks at the end. Shrinking first moves the used blocks out of the part that
+  is cut off into free blocks below it and points every inode, including the ones
+  kept by snapshots, at the new places. The image file follows on close.
+*/
+void resize(char* count_str)
+{
+  long new_num = parse_offset(count_str);
+  int i, j;
+  if(new_num == -1)
+  {
+    printf("mfs> resize error: Usage: resize <number of blocks>\n");
+    return;
+  }
+  if(file_d == NULL)
+  {
+    printf("mfs> resize error: No open fs.\n");
+    return;
+  }
+  if(new_num <= BLOCK_START_INDEX || new_num > MAX_BLOCK_NUM)
+  {
+    printf("mfs> resize error: Size must be between %d and %d blocks.\n",
+      BLOCK_START_INDEX + 1, MAX_BLOCK_NUM);
+    return;
+  }
+  if(new_num >= block_num)
+  {
+    for(i = block_num; i < new_num; i++)
+    {
+      free_block_list[i] = 1;
+      block_refs[i] = 0;
+    }
+    block_num = new_num;
+    superblock->block_count = block_num;
+    return;
+  }
+
+  // checks that the used blocks of the tail fit in the free blocks below it
+  int moving = 0;
+  int space = 0;
+  for(i = BLOCK_START_INDEX; i < block_num; i++)
+  {
+    if(i >= new_num)
+    {
+      moving += free_block_list[i] == 0;
+    }
+    else
+    {
+      space += free_block_list[i] == 1;
+    }
+  }
+  if(moving > space)
+  {
+    printf("mfs> resize error: Not enough disk space.\n");
+    return;
+  }
+
+  // moves every used block of the tail to the first free block below the new end
+  int * moved = (int *) calloc(block_num, sizeof(int));
+  int target = BLOCK_START_INDEX;
+  for(i = new_num; i < block_num; i++)
+  {
+    if(free_block_list[i] == 1)
+    {
+      continue;
+    }
+    while(free_block_list[target] == 0)
+    {
+      target++;
+    }
+    memcpy(blocks[target], blocks[i], BLOCK_SIZE);
+    free_block_list[target] = 0;
+    block_refs[target] = block_refs[i];
+    moved[i] = target;
+  }
+  for(i = 0; i < NUM_FILE; i++)
+  {
+    if(free_inode_list[i] == 1)
+    {
+      continue;
+    }
+    for(j = 0; j < file_blocks(inodes_list[i].size); j++)
+    {
+      if(inodes_list[i].blocks[j] >= new_num)
+      {
+        inodes_list[i].blocks[j] = moved[inodes_list[i].blocks[j]];
+      }
+    }
+  }
+  free(moved);
+  for(i = new_num; i < block_num; i++)
+  {
+    free_block_list[i] = 0;
+    block_refs[i] = 0;
+  }
+  block_num = new_num;
+  superblock->block_count = block_num;
+}
+
+/*
+  clone_file is a void function that accepts two char pointer as parameter.
+  This function makes a copy of a file inside the file system without
+  copying any data. The new file shares the inode of the original one and
+  gets its own copy only when one of them is changed.
+*/
+void clone_file(char* filename, char* newfilename)
+{
+  if(filename == NULL || newfilename == NULL)
+  {
+    printf("mfs> clone error: Usage: clone <file> <new file>\n");
+    return;
+  }
+  if(strlen(newfilename) >= FILENAME_LEN)
+  {
+    printf("mfs> clone error: New file name too long.\n");
+    return;
+  }
+  int filenum = file_searcher(filename);
+  if(filenum == -1)
+  {
+    printf("mfs> clone error: File not found\n");
+    return;
+  }
+  if(file_searcher(newfilename) != -1)
+  {
+    printf("mfs> clone error: File already exists.\n");
+    return;
+  }
+  if(inode_refs[dir[filenum].inode] == MAX_REFS)
+  {
+    printf("mfs> clone error: Too many copies of that file.\n");
+    return;
+  }
+  int newnum = find_free_dir();
+  if(newnum == -1)
+  {
+    printf("mfs> clone error: Directory is full.\n");
+    return;
+  }
+  // the new directory entry points at the same inode as the original file.
+  dir[newnum].inode = dir[filenum].inode;
+  inode_refs[dir[newnum].inode]++;
+  entry_name(&dir[newnum], newfilename);
+  dir[newnum].timestamp = time(NULL);
+  entry_sync(newnum);
+}
+
+/*snapshot_dir function returns the saved directory of the snapshot at the given slot.*/
+Directory_Entry * snapshot_dir(int slot)
+{
+  return (Directory_Entry *) &blocks[SNAPSHOT_START_INDEX + slot * SNAPSHOT_BLOCKS];
+}
+
+/*refs_overflow function checks the share counts of the inodes after the files of
+the removed directory drop their inode and the files of the added directory take
+theirs. Returns the index of a file in the added directory whose inode would get
+more than MAX_REFS extra owners, or -1 if every count fits. removed can be NULL. */
+int refs_overflow(Directory_Entry* removed, Directory_Entry* added)
+{
+  int count[NUM_FILE];
+  int i;
+  for(i = 0; i < NUM_FILE; i++)
+  {
+    count[i] = inode_refs[i];
+  }
+  for(i = 0; removed != NULL && i < NUM_FILE; i++)
+  {
+    if(removed[i].valid != 0)
+    {
+      count[removed[i].inode]--;
+    }
+  }
+  for(i = 0; i < NUM_FILE; i++)
+  {
+    if(added[i].valid != 0)
+    {
+      count[added[i].inode]++;
+    }
+  }
+  for(i = 0; i < NUM_FILE; i++)
+  {
+    if(added[i].valid != 0 && count[added[i].inode] > MAX_REFS)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*snapshot_searcher function searches for a snapshot by name and returns its slot.*/
+int snapshot_searcher(char* name)
+{
+  int i;
+  for(i = 0; i < MAX_SNAPSHOT; i++)
+  {
+    if(snapshots[i].valid != 0 && strcmp(name, snapshots[i].name) == 0)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*
+  snapshot_create is a void function that accepts one char pointer as parameter.
+  A snapshot only saves the directory and adds an owner to the inode of every
+  file. No data block is touched, the blocks get copied when they are written later.
+*/
+void snapshot_create(char* name)
+{
+  int i;
+  int slot = -1;
+  if(strlen(name) >= FILENAME_LEN)
+  {
+    printf("mfs> snapshot error: Snapshot name too long.\n");
+    return;
+  }
+  if(snapshot_searcher(name) != -1)
+  {
+    printf("mfs> snapshot error: Snapshot already exists.\n");
+    return;
+  }
+  for(i = 0; i < MAX_SNAPSHOT; i++)
+  {
+    if(snapshots[i].valid == 0)
+    {
+      slot = i;
+      break;
+    }
+  }
+  if(slot == -1)
+  {
+    printf("mfs> snapshot error: Too many snapshots.\n");
+    return;
+  }
+  // every file using an inode adds one owner to it
+  i = refs_overflow(NULL, dir);
+  if(i != -1)
+  {
+    printf("mfs> snapshot error: Too many copies of %.32s.\n", dir[i].name);
+    return;
+  }
+
+  // saves the directory and adds the snapshot as an owner of every inode.
+  memcpy(snapshot_dir(slot), dir, sizeof(Directory_Entry) * NUM_FILE);
+  for(i = 0; i < NUM_FILE; i++)
+  {
+    if(dir[i].valid != 0)
+    {
+      inode_refs[dir[i].inode]++;
+    }
+  }
+  snapshots[slot].valid = 1;
+  strcpy(snapshots[slot].name, name);
+  snapshots[slot].timestamp = time(NULL);
+}
+
+/*snapshot_list function shows every snapshot with the time it was taken and
+the number of files saved in it. */
+void snapshot_list()
+{
+  int i, j;
+  int count = 0;
+  for(i = 0; i < MAX_SNAPSHOT; i++)
+  {
+    if(snapshots[i].valid != 0)
+    {
+      int files = 0;
+      Directory_Entry * saved = snapshot_dir(i);
+      for(j = 0; j < NUM_FILE; j++)
+      {
+        if(saved[j].valid != 0)
+        {
+          files++;
+        }
+      }
+      char text[30];
+      format_time(snapshots[i].timestamp, text);
+      printf("%8d%27s%15s\n", files, text, snapshots[i].name);
+      count++;
+    }
+  }
+  if(count == 0)
+  {
+    printf("mfs> snapshot list: No snapshots found\n");
+  }
+}
+
+/*
+  snapshot_restore is a void function that accepts one char pointer as parameter.
+  It drops every file of the file system and brings back the directory saved in
+  the snapshot. The snapshot is kept so it can be restored again.
+*/
+void snapshot_restore(char* name)
+{
+  int i;
+  int slot = snapshot_searcher(name);
+  if(slot == -1)
+  {
+    printf("mfs> snapshot error: Snapshot not found\n");
+    return;
+  }
+  // the live files drop their inodes and the saved ones take theirs
+  i = refs_overflow(dir, snapshot_dir(slot));
+  if(i != -1)
+  {
+    printf("mfs> snapshot error: Too many copies of %.32s.\n", snapshot_dir(slot)[i].name);
+    return;
+  }
+  for(i = 0; i < NUM_FILE; i++)
+  {
+    if(dir[i].valid != 0)
+    {
+      inode_release(dir[i].inode);
+    }
+  }
+  memcpy(dir, snapshot_dir(slot), sizeof(Directory_Entry) * NUM_FILE);
+  for(i = 0; i < NUM_FILE; i++)
+  {
+    if(dir[i].valid != 0)
+    {
+      inode_refs[dir[i].inode]++;
+    }
+  }
+  index_rebuild();
+}
+
+/*snapshot_delete function drops a snapshot and releases the inodes it owned. */
+void snapshot_delete(char* name)
+{
+  int i;
+  int slot = snapshot_searcher(name);
+  if(slot == -1)
+  {
+    printf("mfs> snapshot error: Snapshot not found\n");
+    return;
+  }
+  Directory_Entry * saved = snapshot_dir(slot);
+  for(i = 0; i < NUM_FILE; i++)
+  {
+    if(saved[i].valid != 0)
+    {
+      inode_release(saved[i].inode);
+    }
+  }
+  memset(saved, 0, SNAPSHOT_BLOCKS * BLOCK_SIZE);
+  memset(&snapshots[slot], 0, sizeof(Snapshot));
+}
+
+/*
+  snapshot is a void function that accepts two char pointer as parameter.
+  It runs the snapshot operation asked by the user.
+*/
+void snapshot(char* operation, char* name)
+{
+  if(operation != NULL && strcmp(operation, "list") == 0)
+  {
+    snapshot_list();
+    return;
+  }
+  if(operation == NULL || name == NULL)
+  {
+    printf("mfs> snapshot error: Usage: snapshot create|restore|delete <name> or snapshot list\n");
+    return;
+  }
+  if(strcmp(operation, "create") == 0)
+  {
+    snapshot_create(name);
+  }
+  else if(strcmp(operation, "restore") == 0)
+  {
+    snapshot_restore(name);
+  }
+  else if(strcmp(operation, "delete") == 0)
+  {
+    snapshot_delete(name);
+  }
+  else
+  {
+    printf("mfs> snapshot error: Unrecognized operation.\n");
+  }
+}
+
+/*
+  A query of find. The ranges are inclusive and an attribute of -1 matches
+  both set and cleared.
+*/
+typedef struct Query
+{
+  char * name;                          // glob the name has to match, or NULL
+  int64_t size_min, size_max;
+  int64_t time_min, time_max;
+  int attributes_h, attributes_r;
+  int sort;                             // KEY_SIZE, KEY_TIME, KEY_NAME or 0 for none
+  int desc;
+  long limit, offset;
+  long skipped, shown;                  // files passed over for the offset and printed so far
+}Query;
+
+/*parse_size function reads a size with an optional K, M or G suffix. Returns -1
+if the size can't be read. */
+int64_t parse_size(char* text)
+{
+  char * end;
+  errno = 0;
+  long long value = strtoll(text, &end, 10);
+  if(end == text || errno != 0 || value < 0)
+  {
+    return -1;
+  }
+  if(*end == 'k' || *end == 'K')
+  {
+    value *= 1024;
+    end++;
+  }
+  else if(*end == 'm' || *end == 'M')
+  {
+    value *= 1024 * 1024;
+    end++;
+  }
+  else if(*end == 'g' || *end == 'G')
+  {
+    value *= 1024LL * 1024 * 1024;
+    end++;
+  }
+  return *end == '\0' ? value : -1;
+}
+
+/*parse_when function reads a point in time given as seconds since the epoch,
+YYYY-MM-DD or YYYY-MM-DDTHH:MM:SS in local time. Returns -1 if it can't be read. */
+int64_t parse_when(char* text)
+{
+  struct tm tm;
+  char * end;
+  if(strspn(text, "0123456789") == strlen(text))
+  {
+    return strtoll(text, NULL, 10);
+  }
+  memset(&tm, 0, sizeof(tm));
+  end = strptime(text, "%Y-%m-%dT%H:%M:%S", &tm);
+  if(end == NULL || *end != '\0')
+  {
+    memset(&tm, 0, sizeof(tm));
+    end = strptime(text, "%Y-%m-%d", &tm);
+    if(end == NULL || *end != '\0')
+    {
+      return -1;
+    }
+  }
+  tm.tm_isdst = -1;
+  return mktime(&tm);
+}
+
+/*parse_range function reads a range written as min..max where either end can be
+left out. Returns -1 if the range can't be read. */
+int parse_range(char* text, int64_t (*parse)(char*), int64_t* min, int64_t* max)
+{
+  char * dots = strstr(text, "..");
+  if(dots == NULL)
+  {
+    // a single value matches only itself
+    *min = *max = parse(text);
+    return *min == -1 ? -1 : 0;
+  }
+  *dots = '\0';
+  if(*text != '\0' && (*min = parse(text)) == -1)
+  {
+    return -1;
+  }
+  if(dots[2] != '\0' && (*max = parse(dots + 2)) == -1)
+  {
+    return -1;
+  }
+  return 0;
+}
+
+/*query_match function checks a file against every predicate of the query.*/
+int query_match(Query* query, int filenum)
+{
+  Directory_Entry * entry = &dir[filenum];
+  if(entry->size < query->size_min || entry->size > query->size_max ||
+    entry->timestamp < query->time_min || entry->timestamp > query->time_max)
+  {
+    return 0;
+  }
+  if((query->attributes_h != -1 && entry->attributes_h != query->attributes_h) ||
+    (query->attributes_r != -1 && entry->attributes_r != query->attributes_r))
+  {
+    return 0;
+  }
+  if(query->name != NULL)
+  {
+    char name[FILENAME_LEN + 1];
+    memcpy(name, entry->name, FILENAME_LEN);
+    name[FILENAME_LEN] = '\0';
+    if(fnmatch(query->name, name, 0) != 0)
+    {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/*query_emit function prints a matching file unless it is still inside the offset.
+Returns 0 once the limit is reached so the caller can stop. */
+int query_emit(Query* query, int filenum)
+{
+  char text[30];
+  if(query->limit >= 0 && query->shown >= query->limit)
+  {
+    return 0;
+  }
+  if(query->skipped < query->offset)
+  {
+    query->skipped++;
+    return 1;
+  }
+  format_time(dir[filenum].timestamp, text);
+  printf("%8d%27s%15.32s\n", dir[filenum].size, text, dir[filenum].name);
+  query->shown++;
+  return query->limit < 0 || query->shown < query->limit;
+}
+
+/*index_lower_bound function returns the first place in an index whose key is not
+below the given value. */
+int index_lower_bound(int* index, int key, int64_t value)
+{
+  int low = 0;
+  int high = index_count;
+  while(low < high)
+  {
+    int mid = (low + high) / 2;
+    if(entry_key(index[mid], key) < value)
+    {
+      low = mid + 1;
+    }
+    else
+    {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+/*compare_names function orders two directory indexes by file name for qsort.*/
+int compare_names(const void* a, const void* b)
+{
+  return strncmp(dir[*(const int*)a].name, dir[*(const int*)b].name, FILENAME_LEN);
+}
+
+/*
+  find is a void function that accepts the tokens of the command as parameter.
+  It prints the files that match every predicate given, sorted and paged as asked:
+    -name <glob> -size <min..max> -time <from..to> -attr <+h|-h|+r|-r>
+    -sort <size|time|name> -desc -limit <n> -offset <n>
+  The size or time index is walked from the start of the asked range and the walk
+  stops at its end, so only files inside the range are looked at. Files are
+  printed as they are found, only a sort by name has to collect them first.
+*/
+void find(char** token)
+{
+  Query query;
+  int i;
+  memset(&query, 0, sizeof(query));
+  query.size_max = INT64_MAX;
+  query.time_max = INT64_MAX;
+  query.attributes_h = -1;
+  query.attributes_r = -1;
+  query.limit = -1;
+
+  for(i = 1; i < MAX_NUM_ARGUMENTS && token[i] != NULL; i++)
+  {
+    char * value = (i + 1 < MAX_NUM_ARGUMENTS) ? token[i + 1] : NULL;
+    int bad = 0;
+    if(strcmp(token[i], "-desc") == 0)
+    {
+      query.desc = 1;
+      continue;
+    }
+    if(value == NULL)
+    {
+      bad = 1;
+    }
+    else if(strcmp(token[i], "-name") == 0)
+    {
+      query.name = value;
+    }
+    else if(strcmp(token[i], "-size") == 0)
+    {
+      bad = parse_range(value, parse_size, &query.size_min, &query.size_max);
+    }
+    else if(strcmp(token[i], "-time") == 0)
+    {
+      bad = parse_range(value, parse_when, &query.time_min, &query.time_max);
+    }
+    else if(strcmp(token[i], "-attr") == 0 && (value[0] == '+' || value[0] == '-'))
+    {
+      if(value[1] == 'h' || value[1] == 'H')
+      {
+        query.attributes_h = value[0] == '+';
+      }
+      else if(value[1] == 'r' || value[1] == 'R')
+      {
+        query.attributes_r = value[0] == '+';
+      }
+      else
+      {
+        bad = 1;
+      }
+    }
+    else if(strcmp(token[i], "-sort") == 0)
+    {
+      if(strcmp(value, "size") == 0)
+      {
+        query.sort = KEY_SIZE;
+      }
+      else if(strcmp(value, "time") == 0)
+      {
+        query.sort = KEY_TIME;
+      }
+      else if(strcmp(value, "name") == 0)
+      {
+        query.sort = KEY_NAME;
+      }
+      else
+      {
+        bad = 1;
+      }
+    }
+    else if(strcmp(token[i], "-limit") == 0)
+    {
+      bad = (query.limit = parse_offset(value)) == -1;
+    }
+    else if(strcmp(token[i], "-offset") == 0)
+    {
+      bad = (query.offset = parse_offset(value)) == -1;
+    }
+    else
+    {
+      bad = 1;
+    }
+    if(bad)
+    {
+      printf("mfs> find error: Invalid predicate %s.\n", token[i]);
+      return;
+    }
+    i++;
+  }
+
+  // walks the index of the sort key, or else the index of a given range
+  int key = query.sort;
+  if(key != KEY_SIZE && key != KEY_TIME)
+  {
+    key = (query.time_min > 0 || query.time_max < INT64_MAX) ? KEY_TIME : KEY_SIZE;
+    if(query.size_min > 0 || query.size_max < INT64_MAX)
+    {
+      key = KEY_SIZE;
+    }
+  }
+  int * index = key == KEY_SIZE ? size_index : time_index;
+  int64_t min = key == KEY_SIZE ? query.size_min : query.time_min;
+  int64_t max = key == KEY_SIZE ? query.size_max : query.time_max;
+  int first = index_lower_bound(index, key, min);
+  int last = (max == INT64_MAX ? index_count : index_lower_bound(index, key, max + 1)) - 1;
+
+  if(query.sort == KEY_NAME)
+  {
+    // a sort by name has no index so the matches are collected and sorted first
+    int matches[NUM_FILE];
+    int count = 0;
+    for(i = first; i <= last; i++)
+    {
+      if(query_match(&query, index[i]))
+      {
+        matches[count++] = index[i];
+      }
+    }
+    qsort(matches, count, sizeof(int), compare_names);
+    for(i = 0; i < count; i++)
+    {
+      if(!query_emit(&query, matches[query.desc ? count - 1 - i : i]))
+      {
+        break;
+      }
+    }
+  }
+  else
+  {
+    for(i = 0; i <= last - first; i++)
+    {
+      int filenum = index[query.desc ? last - i : first + i];
+      if(query_match(&query, filenum) && !query_emit(&query, filenum))
+      {
+        break;
+      }
+    }
+  }
+  if(query.shown == 0)
+  {
+    printf("mfs> find: No files found\n");
+  }
+}
+
+/*elapsed_ns function returns the nanoseconds between two clock readings.*/
+double elapsed_ns(struct timespec* start, struct timespec* end)
+{
+  return (end->tv_sec - start->tv_sec) * 1e9 + (end->tv_nsec - start->tv_nsec);
+}
+
+/*
+  bench_list is a void function that times list and the file search over a full
+  directory. The same 128 files are laid out once in the version 1 layout, where
+  the size and attributes have to be read from the inode of every entry, and
+  once in the version 2 layout. The real directory is put back afterwards.
+*/
+void bench_list(long iterations)
+{
+  Directory_Entry saved[NUM_FILE];
+  Directory_Entry_v1 * old = (Directory_Entry_v1 *) calloc(NUM_FILE, sizeof(Directory_Entry_v1));
+  FILE * out = fopen("/dev/null", "w");
+  struct timespec start, end;
+  char name[FILENAME_LEN];
+  volatile int found = 0;
+  long n;
+  int i;
+
+  memcpy(saved, dir, sizeof(saved));
+  timestamp = time(NULL);
+  for(i = 0; i < NUM_FILE; i++)
+  {
+    snprintf(name, sizeof(name), "bench_file_%03d", i);
+    entry_name(&dir[i], name);
+    dir[i].timestamp = timestamp - i;
+    dir[i].inode = i;
+    dir[i].valid = 1;
+    dir[i].size = inodes_list[i].size;
+    dir[i].attributes_h = 0;
+    dir[i].attributes_r = 0;
+    old[i].valid = 1;
+    strcpy(old[i].name, name);
+    format_time(dir[i].timestamp, old[i].timestamp);
+    old[i].inode = i;
+  }
+  snprintf(name, sizeof(name), "bench_file_%03d", NUM_FILE - 1);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(n = 0; n < iterations; n++)
+  {
+    for(i = 0; i < NUM_FILE; i++)
+    {
+      if(old[i].valid != 0 && inodes_list[old[i].inode].attributes_h != 1)
+      {
+        fprintf(out, "%8d%27s%15s\n", inodes_list[old[i].inode].size, old[i].timestamp, old[i].name);
+      }
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("list   v1: %10.0f ns\n", elapsed_ns(&start, &end) / iterations);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(n = 0; n < iterations; n++)
+  {
+    list_entries(out, NULL);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("list   v2: %10.0f ns\n", elapsed_ns(&start, &end) / iterations);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(n = 0; n < iterations; n++)
+  {
+    for(i = 0; i < NUM_FILE; i++)
+    {
+      if(old[i].valid != 0 && strcmp(name, old[i].name) == 0)
+      {
+        found += i;
+        break;
+      }
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("search v1: %10.0f ns\n", elapsed_ns(&start, &end) / iterations);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(n = 0; n < iterations; n++)
+  {
+    found += file_searcher(name);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  printf("search v2: %10.0f ns\n", elapsed_ns(&start, &end) / iterations);
+
+  memcpy(dir, saved, sizeof(saved));
+  fclose(out);
+  free(old);
+}
+
+/*evict function drops the pages of a file from the page cache.*/
+void evict(char* name)
+{
+  int fd = open(name, O_RDONLY);
+  if(fd != -1)
+  {
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+  }
+}
+
+/*cached_kb function returns how many kilobytes of a file sit in the page cache.*/
+long cached_kb(char* name)
+{
+  struct stat buffer;
+  long pages = 0;
+  long page_size = sysconf(_SC_PAGESIZE);
+  int fd = open(name, O_RDONLY);
+  if(fd == -1 || fstat(fd, &buffer) != 0 || buffer.st_size == 0)
+  {
+    if(fd != -1)
+    {
+      close(fd);
+    }
+    return 0;
+  }
+  size_t count = (buffer.st_size + page_size - 1) / page_size;
+  void * map = mmap(NULL, buffer.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  unsigned char * resident = (unsigned char *) malloc(count);
+  if(map != MAP_FAILED && mincore(map, buffer.st_size, resident) == 0)
+  {
+    size_t i;
+    for(i = 0; i < count; i++)
+    {
+      pages += resident[i] & 1;
+    }
+  }
+  if(map != MAP_FAILED)
+  {
+    munmap(map, buffer.st_size);
+  }
+  free(resident);
+  close(fd);
+  return pages * page_size / 1024;
+}
+
+/*sync_file function flushes a file to the device so writes are timed in full.*/
+void sync_file(char* name)
+{
+  int fd = open(name, O_RDONLY);
+  if(fd != -1)
+  {
+    fdatasync(fd);
+    close(fd);
+  }
+}
+
+/*
+  bench_io is a void function that copies a file of the working directory in and
+  out of the opened file system and saves and loads a copy of the image, once with
+  buffered I/O and once with direct I/O. Every run starts with the files out of
+  the page cache and writes are flushed to the device, and it shows the throughput
+  and how much of each file was left in the page cache. The image throughput counts
+  the metadata and used blocks that are written and read, not the holes.
+*/
+void bench_io(char* hostfile)
+{
+  struct stat buffer;
+  struct timespec start, end;
+  char * copy = "bench_io.tmp";
+  char * out = "bench_io.out";
+  char * image = "bench_io.img";
+  int saved = direct_io;
+  int mode;
+  if(hostfile == NULL || stat(hostfile, &buffer) == -1 || !S_ISREG(buffer.st_mode))
+  {
+    printf("mfs> bench error: Usage: bench io <file>\n");
+    return;
+  }
+  if(file_d == NULL)
+  {
+    printf("mfs> bench error: No open fs.\n");
+    return;
+  }
+  double megabytes = buffer.st_size / 1048576.0;
+  printf("%-9s %10s %10s %10s %10s %10s %10s %10s\n", "mode", "put MB/s", "get MB/s",
+    "save MB/s", "load MB/s", "in KB", "out KB", "image KB");
+  for(mode = 0; mode < 2; mode++)
+  {
+    double put_ns, get_ns, save_ns, load_ns;
+    direct_io = mode;
+    evict(hostfile);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    put(hostfile, copy);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    put_ns = elapsed_ns(&start, &end);
+    if(file_searcher(copy) == -1)
+    {
+      break;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    get(copy, out);
+    sync_file(out);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    get_ns = elapsed_ns(&start, &end);
+    del(copy);
+
+    // saves the image into a new file and loads it back. Only the metadata and the
+    // used blocks are moved, the free blocks are holes, so only they are counted.
+    double image_megabytes = (double)(block_num - free_block_count()) * BLOCK_SIZE / 1048576.0;
+    FILE * fp = fopen(image, "w");
+    fclose(fp);
+    fp = image_open(image);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    image_write(fp);
+    fdatasync(fileno(fp));
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    save_ns = elapsed_ns(&start, &end);
+    fclose(fp);
+    evict(image);
+    fp = image_open(image);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    image_read(fp);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    load_ns = elapsed_ns(&start, &end);
+    fclose(fp);
+
+    printf("%-9s %10.1f %10.1f %10.1f %10.1f %10ld %10ld %10ld\n", mode ? "direct" : "buffered",
+      megabytes / (put_ns / 1e9), megabytes / (get_ns / 1e9),
+      image_megabytes / (save_ns / 1e9), image_megabytes / (load_ns / 1e9),
+      cached_kb(hostfile), cached_kb(out), cached_kb(image));
+    unlink(out);
+    unlink(image);
+  }
+  direct_io = saved;
+}
+
+/*
+  bench is a void function that accepts two char pointer as parameter.
+  bench list [iterations] times list and search, bench io <file> compares
+  buffered and direct I/O.
+*/
+void bench(char* what, char* arg)
+{
+  long iterations = 10000;
+  if(what != NULL && strcmp(what, "io") == 0)
+  {
+    bench_io(arg);
+    return;
+  }
+  if(arg != NULL)
+  {
+    iterations = parse_offset(arg);
+  }
+  if(what == NULL || iterations <= 0)
+  {
+    printf("mfs> bench error: Usage: bench list [iterations] or bench io <file>\n");
+    return;
+  }
+  if(strcmp(what, "list") == 0)
+  {
+    bench_list(iterations);
+  }
+  else
+  {
+    printf("mfs> bench error: Unrecognized benchmark.\n");
+  }
+}
 
-    //inodes_list[dir[filenum].inode].attributes = 3;
+/*
+  An archive holds every file of an image. It starts with ARCHIVE_MAGIC, the
+  version and the number of files, then a header for every file, then the data
+  of the files one after the other in the order of the headers.
+*/
+typedef struct Archive_entry
+{
+  char name[FILENAME_LEN];
+  int64_t timestamp;
+  uint32_t size;
+  uint8_t attributes_h;
+  uint8_t attributes_r;
+}__attribute__((packed)) Archive_entry;
 
-    int block_count = 0;
-    // We want to copy and write in chunks of BLOCK_SIZE. So to do this 
-    // we are going to use fseek to move along our file stream in chunks of BLOCK_SIZE.
-    // We will copy bytes, increment our file pointer by BLOCK_SIZE and repeat.
-    int offset      = 0;               
+/*
+  export_fs is a void function that accepts one char pointer as parameter.
+  It writes every file of the file system with its name, timestamp and attributes
+  into one archive. The whole image is already in the blocks array, so nothing is
+  gained by walking the blocks in image order. The archive is written from start
+  to end instead, so it can also be a pipe, and blocks of a file that follow each
+  other in the image are written with one call.
+*/
+void export_fs(char* archive)
+{
+  Archive_entry entries[NUM_FILE];
+  uint32_t count = 0;
+  int i, j;
+  int failed = 0;
+  if(archive == NULL)
+  {
+    printf("mfs> export error: Usage: export <archive>\n");
+    return;
+  }
+  FILE * ofp = fopen(archive, "w");
+  if(ofp == NULL)
+  {
+    printf("mfs> export error: Could not open %s\n", archive);
+    return;
+  }
 
-    // We are going to copy and store our file in BLOCK_SIZE chunks instead of one big 
-    // memory pool. Why? We are simulating the way the file system stores file data in
-    // blocks of space on the disk. block_index will keep us pointing to the area of
-    // the area that we will read from or write to.
+  // writes the header of every file
+  for(i = 0; i < NUM_FILE; i++)
+  {
+    if(dir[i].valid == 0)
+    {
+      continue;
+    }
+    memcpy(entries[count].name, dir[i].name, FILENAME_LEN);
+    entries[count].timestamp = dir[i].timestamp;
+    entries[count].size = dir[i].size;
+    entries[count].attributes_h = dir[i].attributes_h;
+    entries[count].attributes_r = dir[i].attributes_r;
+    count++;
+  }
+  uint32_t version = ARCHIVE_VERSION;
+  fwrite(ARCHIVE_MAGIC, 4, 1, ofp);
+  fwrite(&version, sizeof(version), 1, ofp);
+  fwrite(&count, sizeof(count), 1, ofp);
+  fwrite(entries, sizeof(Archive_entry), count, ofp);
+
+  // writes the data of every file in the order of the headers
+  for(i = 0; i < NUM_FILE && !failed; i++)
+  {
+    if(dir[i].valid == 0)
+    {
+      continue;
+    }
+    Inode * inode = &inodes_list[dir[i].inode];
+    int num_blocks = file_blocks(dir[i].size);
+    j = 0;
+    while(j < num_blocks && !failed)
+    {
+      int start = j;
+      while(j + 1 < num_blocks && inode->blocks[j + 1] == inode->blocks[j] + 1)
+      {
+        j++;
+      }
+      j++;
+      uint32_t skipped = (uint32_t) start * BLOCK_SIZE;
+      uint32_t length = j == num_blocks ? dir[i].size - skipped : (uint32_t)(j - start) * BLOCK_SIZE;
+      failed = length > 0 && fwrite(blocks[inode->blocks[start]], length, 1, ofp) != 1;
+      op_bytes += length;
+    }
+  }
+  if(fclose(ofp) != 0 || failed)
+  {
+    printf("mfs> export error: Could not write %s\n", archive);
+  }
+}
 
-    // copy_size is initialized to the size of the input file so each loop iteration we
-    // will copy BLOCK_SIZE bytes from the file then reduce our copy_size counter by
-    // BLOCK_SIZE number of bytes. When copy_size is less than or equal to zero we know
-    // we have copied all the data from the input file.
-    while( copy_size > 0 )
+/*find_free_run function finds count free blocks in a row and takes them. Returns the
+first block of the run, or -1 if there is no such run. */
+int find_free_run(int count)
+{
+  int i;
+  int run = 0;
+  for(i = BLOCK_START_INDEX; i < block_num; i++)
+  {
+    run = free_block_list[i] == 1 ? run + 1 : 0;
+    if(run == count)
     {
-      int block_index = find_free_block();
-      // finds a free block from tbhe free block list
+      int start = i - count + 1;
+      memset(&free_block_list[start], 0, count);
+      return start;
+    }
+  }
+  return -1;
+}
 
-      // stores the index of the data bloc k in the inode
-      inodes_list[filenum].blocks[block_count]= block_index;
+/*
+  import_fs is a void function that accepts one char pointer as parameter.
+  It adds every file of an archive to the file system with its name, timestamp
+  and attributes. The archive is read once from start to end straight into the
+  blocks, and every file is put in free blocks that follow each other when there
+  are enough of them, so files are laid out in one piece.
+*/
+void import_fs(char* archive)
+{
+  Archive_entry entries[NUM_FILE];
+  char magic[4];
+  uint32_t version, count;
+  uint32_t i, k;
+  int j;
+  if(archive == NULL)
+  {
+    printf("mfs> import error: Usage: import <archive>\n");
+    return;
+  }
+  FILE * ifp = fopen(archive, "r");
+  if(ifp == NULL)
+  {
+    printf("mfs> import error: File not found\n");
+    return;
+  }
+  if(fread(magic, 4, 1, ifp) != 1 || fread(&version, sizeof(version), 1, ifp) != 1 ||
+    fread(&count, sizeof(count), 1, ifp) != 1 || memcmp(magic, ARCHIVE_MAGIC, 4) != 0 ||
+    version != ARCHIVE_VERSION || count > NUM_FILE ||
+    fread(entries, sizeof(Archive_entry), count, ifp) != count)
+  {
+    printf("mfs> import error: %s is not an archive.\n", archive);
+    fclose(ifp);
+    return;
+  }
 
+  // checks every file before anything is added
+  int needed = 0;
+  uint32_t free_dirs = 0;
+  uint32_t free_inodes = 0;
+  for(i = 0; i < NUM_FILE; i++)
+  {
+    free_dirs += dir[i].valid == 0;
+    // snapshots keep the inodes of deleted files, so there can be fewer than free slots
+    free_inodes += free_inode_list[i] == 1;
+  }
+  for(i = 0; i < count; i++)
+  {
+    char name[FILENAME_LEN + 1];
+    memcpy(name, entries[i].name, FILENAME_LEN);
+    name[FILENAME_LEN] = '\0';
+    if(file_searcher(name) != -1)
+    {
+      printf("mfs> import error: %s already exists.\n", name);
+      fclose(ifp);
+      return;
+    }
+    for(k = 0; k < i && strncmp(entries[k].name, entries[i].name, FILENAME_LEN) != 0; k++);
+    if(k < i)
+    {
+      printf("mfs> import error: %s is in the archive twice.\n", name);
+      fclose(ifp);
+      return;
+    }
+    if(file_blocks(entries[i].size) > BLOCK_FOR_A_FILE)
+    {
+      printf("mfs> import error: %s is too big.\n", name);
+      fclose(ifp);
+      return;
+    }
+    needed += file_blocks(entries[i].size);
+  }
+  if(count > free_dirs || count > free_inodes || needed > free_block_count())
+  {
+    printf("mfs> import error: Not enough disk space.\n");
+    fclose(ifp);
+    return;
+  }
 
-      // Index into the input file by offset number of bytes.  Initially offset is set to
-      // zero so we copy BLOCK_SIZE number of bytes from the front of the file.  We 
-      // then increase the offset by BLOCK_SIZE and continue the process.  This will
-      // make us copy from offsets 0, BLOCK_SIZE, 2*BLOCK_SIZE, 3*BLOCK_SIZE, etc.
-      fseek( ifp, offset, SEEK_SET );
+  for(i = 0; i < count; i++)
+  {
+    int filenum = find_free_dir();
+    int inode = find_free_inode();
+    int num_blocks = file_blocks(entries[i].size);
+    int start = find_free_run(num_blocks);
+    int failed = 0;
+    Inode * node = &inodes_list[inode];
+    for(j = 0; j < num_blocks; j++)
+    {
+      node->blocks[j] = start != -1 ? start + j : find_free_block();
+    }
+    if(start != -1 && num_blocks > 0)
+    {
+      // the whole file is read into its run of blocks at once
+      failed = fread(blocks[start], entries[i].size, 1, ifp) != 1;
+    }
+    for(j = 0; start == -1 && j < num_blocks && !failed; j++)
+    {
+      uint32_t remaining = entries[i].size - j * BLOCK_SIZE;
+      failed = fread(blocks[node->blocks[j]], remaining < BLOCK_SIZE ? remaining : BLOCK_SIZE,
+        1, ifp) != 1;
+    }
+    node->size = entries[i].size;
+    node->attributes_h = entries[i].attributes_h;
+    node->attributes_r = entries[i].attributes_r;
+    dir[filenum].inode = inode;
+    if(failed)
+    {
+      // gives back the blocks of the file that could not be read
+      inode_release(inode);
+      dir[filenum].valid = 0;
+      dir[filenum].inode = -1;
+      printf("mfs> import error: An error occured reading from the archive.\n");
+      break;
+    }
+    memcpy(dir[filenum].name, entries[i].name, FILENAME_LEN);
+    dir[filenum].hash = name_hash(dir[filenum].name);
+    dir[filenum].timestamp = entries[i].timestamp;
+    entry_sync(filenum);
+    op_bytes += entries[i].size;
+  }
+  fclose(ifp);
+}
 
-      // Read BLOCK_SIZE number of bytes from the input file and store them in our
-      // data array. 
-      int bytes  = fread( blocks[block_index], BLOCK_SIZE, 1, ifp );
+/*
+  A trace records every command run through dispatch as a record of the time it
+  started in nanoseconds since the trace began, how long it took, how many bytes
+  of file data it moved and its tokens, each stored as a length and the text.
+  The file starts with TRACE_MAGIC and TRACE_VERSION.
+*/
+typedef struct Trace_record
+{
+  uint64_t start_ns;
+  uint64_t latency_ns;
+  uint64_t bytes;
+  uint8_t token_count;
+}__attribute__((packed)) Trace_record;
 
-      // If bytes == 0 and we haven't reached the end of the file then something is 
-      // wrong. If 0 is returned and we also have the EOF flag set then that is OK.
-      // It means we've reached the end of our input file.
-      if( bytes == 0 && !feof( ifp ) )
-      {
-        printf("mfs> An error occured reading from the input file.\n");
-        return;
-      }
+FILE * trace_file = NULL;               //trace the commands are recorded into, if any
+struct timespec trace_start;            //time the trace began
 
-      // Clear the EOF file flag.
-      clearerr( ifp );
+/*trace_write function adds a record with the given tokens to a trace.*/
+void trace_write(FILE* fp, uint64_t start_ns, uint64_t latency_ns, uint64_t bytes, char** token)
+{
+  Trace_record record;
+  int i;
+  record.start_ns = start_ns;
+  record.latency_ns = latency_ns;
+  record.bytes = bytes;
+  record.token_count = 0;
+  while(record.token_count < MAX_NUM_ARGUMENTS && token[record.token_count] != NULL)
+  {
+    record.token_count++;
+  }
+  fwrite(&record, sizeof(record), 1, fp);
+  for(i = 0; i < record.token_count; i++)
+  {
+    uint8_t length = strlen(token[i]);
+    fwrite(&length, 1, 1, fp);
+    fwrite(token[i], length, 1, fp);
+  }
+}
 
-      // Reduce copy_size by the BLOCK_SIZE bytes.
-      copy_size -= BLOCK_SIZE;
+/*trace_read function reads the next record of a trace and fills the tokens with
+newly allocated strings. Returns 0 at the end of the trace. */
+int trace_read(FILE* fp, Trace_record* record, char** token)
+{
+  int i;
+  memset(token, 0, MAX_NUM_ARGUMENTS * sizeof(char*));
+  if(fread(record, sizeof(Trace_record), 1, fp) != 1 || record->token_count > MAX_NUM_ARGUMENTS)
+  {
+    return 0;
+  }
+  for(i = 0; i < record->token_count; i++)
+  {
+    uint8_t length;
+    if(fread(&length, 1, 1, fp) != 1)
+    {
+      return 0;
+    }
+    token[i] = (char *) calloc(length + 1, 1);
+    if(fread(token[i], length, 1, fp) != 1 && length > 0)
+    {
+      return 0;
+    }
+  }
+  return 1;
+}
 
-      // Increase the offset into our input file by BLOCK_SIZE.  This will allow
-      // the fseek at the top of the loop to position us to the correct spot.
-      offset    += BLOCK_SIZE;
+/*free_tokens function frees the tokens filled in by trace_read.*/
+void free_tokens(char** token)
+{
+  int i;
+  for(i = 0; i < MAX_NUM_ARGUMENTS; i++)
+  {
+    free(token[i]);
+    token[i] = NULL;
+  }
+}
 
-      // Increment the index into the block array 
-      block_count ++;
+/*trace_open function opens a trace for reading or writing and checks its header.*/
+FILE * trace_open(char* path, char* mode)
+{
+  FILE * fp = fopen(path, mode);
+  char magic[4];
+  uint32_t version = TRACE_VERSION;
+  if(fp == NULL)
+  {
+    return NULL;
+  }
+  if(mode[0] == 'w')
+  {
+    fwrite(TRACE_MAGIC, 4, 1, fp);
+    fwrite(&version, sizeof(version), 1, fp);
+  }
+  else if(fread(magic, 4, 1, fp) != 1 || fread(&version, sizeof(version), 1, fp) != 1 ||
+    memcmp(magic, TRACE_MAGIC, 4) != 0 || version != TRACE_VERSION)
+  {
+    fclose(fp);
+    return NULL;
+  }
+  return fp;
+}
+
+/*
+  trace is a void function that accepts two char pointer as parameter.
+  trace start <file> begins recording every command into the file and
+  trace stop ends the recording.
+*/
+void trace(char* operation, char* path)
+{
+  if(operation != NULL && strcmp(operation, "stop") == 0)
+  {
+    if(trace_file == NULL)
+    {
+      printf("mfs> trace error: No trace is being recorded.\n");
+      return;
     }
+    fclose(trace_file);
+    trace_file = NULL;
+    return;
+  }
+  if(operation == NULL || strcmp(operation, "start") != 0 || path == NULL)
+  {
+    printf("mfs> trace error: Usage: trace start <file> or trace stop\n");
+    return;
+  }
+  if(trace_file != NULL)
+  {
+    fclose(trace_file);
+  }
+  trace_file = trace_open(path, "w");
+  if(trace_file == NULL)
+  {
+    printf("mfs> trace error: Could not open %s\n", path);
+    return;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &trace_start);
+}
 
-    // We are done copying from the input file so close it out.
-    fclose( ifp );
+/*
+  execute is a void function that accepts the tokens of a command as parameter.
+  The first token is compared to check for the respective functionality in the
+  program and the rest are passed on as its arguments.
+*/
+void execute(char** token)
+{
+  if(token[0] == NULL)
+  {
+    return;
   }
-  return;
+  else if(strcmp(token[0],"put")==0)
+  {
+    // puts a file form the current working directory into the file sys.
+    put(token[1], token[2]);
+  }
+  else if(strcmp(token[0],"get")==0)
+  {
+    // gets the file from the file sys and adds it to the working directory.
+    get(token[1],token[2]);
+  }
+  else if(strcmp(token[0],"del")==0)
+  {
+    // deletes a file from the file system
+    del(token[1]);
+  }
+  else if(strcmp(token[0],"list")==0)
+  {
+    // list all the files in the file system.
+    list(token[1]);
+  }
+  else if(strcmp(token[0],"df")==0)
+  { 
+    // dislplays the available free space in the file system.
+    df();
+  }
+  else if(strcmp(token[0],"open")==0)
+  {
+    // opens a requested file system if possible
+    fs_open(token[1]);
+  }
+  else if(strcmp(token[0],"close")==0)  
+  {
+    // closes a open file system
+    fs_close();
+  }
+  else if(strcmp(token[0],"createfs")==0) 
+  {
+    // creates a empty file system with the given name
+    create_fs(token[1]);
+  }
+  else if(strcmp(token[0],"attrib")==0)
+  {
+    // sets the attribute of a file present in the file system
+    attrib(token[1], token[2]);
+  }
+  else if(strcmp(token[0],"read")==0)
+  {
+    // prints a range of bytes of a file in the file system
+    read_file(token[1], token[2], token[3]);
+  }
+  else if(strcmp(token[0],"write")==0)
+  {
+    // writes the content of a file at an offset of a file in the file system
+    write_file("write", token[1], token[2], token[3]);
+  }
+  else if(strcmp(token[0],"append")==0)
+  {
+    // adds the content of a file at the end of a file in the file system
+    write_file("append", token[1], NULL, token[2]);
+  }
+  else if(strcmp(token[0],"clone")==0)
+  {
+    // copies a file inside the file system without copying its data
+    clone_file(token[1], token[2]);
+  }
+  else if(strcmp(token[0],"snapshot")==0)
+  {
+    // creates, lists, restores or deletes snapshots of the file system
+    snapshot(token[1], token[2]);
+  }
+  else if(strcmp(token[0],"find")==0)
+  {
+    // lists the files that match the given predicates
+    find(token);
+  }
+  else if(strcmp(token[0],"resize")==0)
+  {
+    // grows or shrinks the file system to the given number of blocks
+    resize(token[1]);
+  }
+  else if(strcmp(token[0],"trim")==0)
+  {
+    // gives the space of the free blocks back to the host
+    trim();
+  }
+  else if(strcmp(token[0],"direct")==0)
+  {
+    // turns direct I/O on or off
+    direct(token[1]);
+  }
+  else if(strcmp(token[0],"export")==0)
+  {
+    // writes every file of the file system into one archive
+    export_fs(token[1]);
+  }
+  else if(strcmp(token[0],"import")==0)
+  {
+    // adds every file of an archive to the file system
+    import_fs(token[1]);
+  }
+  else if(strcmp(token[0],"trace")==0)
+  {
+    // starts or stops recording the commands into a trace
+    trace(token[1], token[2]);
+  }
+  else if(strcmp(token[0],"convert")==0)
+  {
+    // converts an image of the old layout into the current one
+    convert(token[1]);
+  }
+  else if(strcmp(token[0],"bench")==0)
+  {
+    // times the operations of the file system
+    bench(token[1], token[2]);
+  }
+  else
+  {
+    printf("mfs> Command not found. Try Again!!!\n");
+  }
+}
+
+/*
+  dispatch is a void function that runs a command and records it into the
+  trace when one is being recorded.
+*/
+void dispatch(char** token)
+{
+  struct timespec start, end;
+  if(trace_file == NULL || token[0] == NULL || strcmp(token[0], "trace") == 0)
+  {
+    execute(token);
+    return;
+  }
+  op_bytes = 0;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  execute(token);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  trace_write(trace_file, elapsed_ns(&trace_start, &start), elapsed_ns(&start, &end),
+    op_bytes, token);
+}
+
+/*
+  The latencies of every kind of command seen during a replay, kept so their
+  distribution can be shown at the end.
+*/
+typedef struct Op_latencies
+{
+  char name[16];
+  uint64_t * latency_ns;
+  uint64_t bytes;
+  long count, capacity;
+}Op_latencies;
+
+/*compare_latencies function orders two latencies for qsort.*/
+int compare_latencies(const void* a, const void* b)
+{
+  uint64_t x = *(const uint64_t*)a;
+  uint64_t y = *(const uint64_t*)b;
+  return x < y ? -1 : x > y;
 }
 
 /*
-  list is a void function that accepts one char pointer as parameter.
-  This function lists all the files that are present in the file system
-  along with showing their timestamp and size.
-  It doesn't show hidden files in default but shows hidden file if -h is 
-  passed as a parameter. 
+  replay is an int function that runs every command of a trace against a fresh
+  image, or the given one, and prints the count, bytes moved and latency
+  percentiles in microseconds of each kind of command. Commands run as fast as
+  possible, or at the pace they were recorded at when pacing is set. The trace
+  chooses its own image, so open, close, createfs and trace commands are skipped.
 */
-void list(char* data)
+int replay(char* path, char* image, int pacing)
 {
-  int i ;
-  int count =0; // counter for number of files in the system.
-  // runs through the loop ih the dir list for to check for the files 
-  for(i=0;i<128;i++)
+  Op_latencies ops[32];
+  int op_count = 0;
+  Trace_record record;
+  char *token[MAX_NUM_ARGUMENTS];
+  char fresh[] = "/tmp/mfs-replay-XXXXXX";
+  struct timespec begin, start, end;
+  int i;
+
+  FILE * fp = trace_open(path, "r");
+  if(fp == NULL)
   {
-    // checks for the validity of the file
-    if(dir[i].valid != 0)
+    fprintf(stderr, "mfs-replay: %s is not a trace\n", path);
+    return 1;
+  }
+  if(image == NULL)
+  {
+    close(mkstemp(fresh));
+    image = fresh;
+    create_fs(image);
+  }
+  fs_open(image);
+  if(file_d == NULL)
+  {
+    fclose(fp);
+    return 1;
+  }
+
+  // the output of the commands is thrown away so only the report is shown
+  fflush(stdout);
+  int saved_stdout = dup(STDOUT_FILENO);
+  FILE * null_fp = fopen("/dev/null", "w");
+  dup2(fileno(null_fp), STDOUT_FILENO);
+
+  clock_gettime(CLOCK_MONOTONIC, &begin);
+  while(trace_read(fp, &record, token))
+  {
+    if(token[0] == NULL || strcmp(token[0], "open") == 0 || strcmp(token[0], "close") == 0 ||
+      strcmp(token[0], "createfs") == 0 || strcmp(token[0], "trace") == 0 ||
+      strcmp(token[0], "quit") == 0 || strcmp(token[0], "exit") == 0)
+    {
+      free_tokens(token);
+      continue;
+    }
+    if(pacing)
     {
-      //checks for the hidden file 
-      if(inodes_list[dir[i].inode].attributes_h == 1)
+      // waits for the time the command started at in the trace
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      double wait = record.start_ns - elapsed_ns(&begin, &start);
+      if(wait > 0)
       {
-        if(data!= NULL)
-        {
-          // DISPLAYS THE HIDDEN FILE IF USER HAS PROMPTED TO DO SO.
-          if(data[1]=='h'||data[1]=='H')
-          {
-            printf("%8d%27s%15s\n", inodes_list[dir[i].inode].size, 
-              dir[i].timestamp,dir[i].name);
-            count++;
-          }
-        }
+        struct timespec pause = { (time_t)(wait / 1e9), (long) fmod(wait, 1e9) };
+        nanosleep(&pause, NULL);
       }
-      // shes the regular files that are not hidden
-      else
+    }
+    op_bytes = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    execute(token);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    for(i = 0; i < op_count && strncmp(ops[i].name, token[0], sizeof(ops[i].name) - 1) != 0; i++);
+    if(i == op_count && op_count < 32)
+    {
+      memset(&ops[i], 0, sizeof(Op_latencies));
+      strncpy(ops[i].name, token[0], sizeof(ops[i].name) - 1);
+      op_count++;
+    }
+    // commands past the first 32 kinds are run but not reported
+    if(i < op_count)
+    {
+      if(ops[i].count == ops[i].capacity)
       {
-        printf("%8d%27s%15s\n", inodes_list[dir[i].inode].size , 
-          dir[i].timestamp ,dir[i].name);
-        count++;
+        ops[i].capacity = ops[i].capacity ? ops[i].capacity * 2 : 64;
+        ops[i].latency_ns = (uint64_t *) realloc(ops[i].latency_ns, ops[i].capacity * sizeof(uint64_t));
       }
+      ops[i].latency_ns[ops[i].count++] = elapsed_ns(&start, &end);
+      ops[i].bytes += op_bytes;
     }
+    free_tokens(token);
   }
-  // if no files are found in the system shoes no file found.
-  if(count ==0)
+  // a record cut off at the end of the trace may have left some tokens behind
+  free_tokens(token);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  fflush(stdout);
+  dup2(saved_stdout, STDOUT_FILENO);
+  close(saved_stdout);
+  fclose(null_fp);
+  fclose(fp);
+  fs_close();
+  if(image == fresh)
   {
-    printf("mfs> list: No files found\n");
+    unlink(fresh);
   }
 
+  printf("%-10s %8s %12s %10s %10s %10s %10s %10s\n", "op", "count", "bytes",
+    "mean us", "p50 us", "p90 us", "p99 us", "max us");
+  for(i = 0; i < op_count; i++)
+  {
+    uint64_t * l = ops[i].latency_ns;
+    long n = ops[i].count;
+    double total = 0;
+    long j;
+    qsort(l, n, sizeof(uint64_t), compare_latencies);
+    for(j = 0; j < n; j++)
+    {
+      total += l[j];
+    }
+    printf("%-10s %8ld %12llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", ops[i].name, n,
+      (unsigned long long) ops[i].bytes, total / n / 1e3, l[(n - 1) / 2] / 1e3,
+      l[(n - 1) * 90 / 100] / 1e3, l[(n - 1) * 99 / 100] / 1e3, l[n - 1] / 1e3);
+    free(l);
+  }
+  printf("total %.3f s\n", elapsed_ns(&begin, &end) / 1e9);
+  return 0;
 }
 
-/*
-  del is a void function that accepts one char pointer as parameter.
-  This function deletes the file if present in the file system. 
-  It can't delete a read only file and throws error if you try to do it.
-*/
-void del(char* filename)
+/*normal function draws a number from the standard normal distribution.*/
+double normal()
 {
+  return sqrt(-2.0 * log(1.0 - drand48())) * cos(2.0 * M_PI * drand48());
+}
 
-  int filenum = file_searcher(filename);
-  // checks if a file is found or not
-  if(filenum ==-1){
-    printf("mfs> del error: File not found\n");
-    return;
-  }
-  //checks if a file is read only or not
-  if(inodes_list[dir[filenum].inode].attributes_r == 1 )
+/*write_host_file function makes a file of the working directory with size bytes
+of made up data for the generated workload. */
+int write_host_file(char* name, long size)
+{
+  uint8_t data[BLOCK_SIZE];
+  FILE * fp = fopen(name, "w");
+  long i;
+  if(fp == NULL)
   {
-    printf("mfs> del error: That file is marked read-only.\n");
-    return;
+    return -1;
   }
-  int i;
-
-  // clears the attributes from the fle
-  inodes_list[dir[filenum].inode].attributes_r = 0;
-  inodes_list[dir[filenum].inode].attributes_h = 0;
-  inodes_list[dir[filenum].inode].size = 0;
-  // clears the size of the inode of the file
-  // frees all the pointed data blocks from the inode
-  for(i=0;i<1250;i++)
+  while(size > 0)
   {
-    if(inodes_list[dir[filenum].inode].blocks[i] != -1)
+    long num_bytes = size < BLOCK_SIZE ? size : BLOCK_SIZE;
+    for(i = 0; i < num_bytes; i++)
     {
-      // frees the data block for the free block list which can be later used by other files.
-      free_block_list[inodes_list[dir[filenum].inode].blocks[i]] = 1;
-      inodes_list[dir[filenum].inode].blocks[i] = -1;
+      data[i] = lrand48();
     }
-
+    fwrite(data, num_bytes, 1, fp);
+    size -= num_bytes;
   }
-  // frees the inode adn adds it to the free inode list.
-  free_inode_list[dir[filenum].inode] = 1;
-  // makes the dir available for future reuse.
-    dir[filenum].valid = 0;
-    // sets name, timestamp to 0 and removes the inode for m the dir
-    memset(dir[filenum].name,0,32);
-    memset(dir[filenum].timestamp,0,30);
-    dir[filenum].inode = -1;
-}
-
-/*
-  df is a void function that doesn't have any parameters.
-  This function just prints the total free space avaialble in the filesystem.
-*/
-void df()
-{
-  printf("%d bytes free.\n", BLOCK_SIZE* (BLOCK_NUM - 8) - disk_size() );
+  fclose(fp);
+  return 0;
 }
 
 /*
-  get is a void function that accepts two char pointer as parameter.
-  This function copies the file if present into the working directory 
-  It also renames the file to a new file name if provided by the user.
+  generate is an int function that writes a made up trace of the given number of
+  commands. File sizes follow a log-normal distribution around the median size and
+  the commands are drawn with the weights of the mix, e.g. put=30,get=25,del=10.
+  Commands are spaced by exponential gaps of one millisecond on average. The files
+  put by the trace are made in the working directory, so the trace can be replayed
+  from there. The same seed always gives the same trace.
 */
-void get(char* filename, char* newfilename)
+int generate(char* path, long count, long seed, char* mix, long median)
 {
-  //checks if a newfile name is provided or not
-  if(newfilename!= NULL)
+  char * names[] = { "put", "get", "read", "append", "del", "list", "find", "df" };
+  int weights[8] = { 30, 25, 20, 10, 10, 5, 0, 0 };
+  int num_ops = 8;
+  char live[NUM_FILE][FILENAME_LEN];
+  long sizes[NUM_FILE];
+  int live_count = 0;
+  long used = 0;
+  long budget = (long)(BLOCK_NUM - BLOCK_START_INDEX) * BLOCK_SIZE * 8 / 10;
+  long max_size = (long) BLOCK_FOR_A_FILE * BLOCK_SIZE / 2;
+  long append_size = 4096;
+  double now = 0;
+  int next_id = 0;
+  long n;
+  int i;
 
+  if(mix != NULL)
   {
-    if(strlen(newfilename)>32)
+    // only the commands named in the mix are drawn
+    char * copy = strdup(mix);
+    char * item;
+    char * rest = copy;
+    memset(weights, 0, sizeof(weights));
+    while((item = strsep(&rest, ",")) != NULL)
     {
-      // checks for the length of the file
-      printf("mfs> get error: New file name too long.\n");
-      return;
+      char * equal = strchr(item, '=');
+      for(i = 0; equal != NULL && i < num_ops; i++)
+      {
+        if(strncmp(item, names[i], equal - item) == 0 && strlen(names[i]) == (size_t)(equal - item))
+        {
+          weights[i] = atoi(equal + 1);
+          break;
+        }
+      }
+      if(equal == NULL || i == num_ops)
+      {
+        fprintf(stderr, "mfs: unknown command in mix: %s\n", item);
+        free(copy);
+        return 1;
+      }
     }
+    free(copy);
   }
-
-  int block_count = 0;
-  // searches the index of the file that is requested form the file sys.
-  int filenum = file_searcher(filename);
-  if(filenum ==-1){
-    printf("mfs> get error: File not found\n");
-    return;
-  }
-
-  FILE *ofp;
-  // if newfilename is given it opens it otherwise it uses the deafult filename 
-  if(newfilename == NULL)
+  int total_weight = 0;
+  for(i = 0; i < num_ops; i++)
   {
-    ofp = fopen(filename, "w");
+    total_weight += weights[i];
   }
-  else
+  if(total_weight <= 0)
   {
-    ofp = fopen(newfilename, "w");
+    fprintf(stderr, "mfs: the mix has no commands\n");
+    return 1;
   }
-  if( ofp == NULL )
+
+  FILE * fp = trace_open(path, "w");
+  if(fp == NULL)
   {
-    printf("mfs> Could not open output file: %s\n", filename );
-    return ;
+    fprintf(stderr, "mfs: could not open %s\n", path);
+    return 1;
   }
-    // Initialize our offsets and pointers just we did above when reading from the file.
-
-  // assign the copy size of the file
-  int copy_size   = inodes_list[dir[filenum].inode].size;
-  int offset      = 0;
+  srand48(seed);
+  write_host_file("wl_append.dat", append_size);
 
-    // Using copy_size as a count to determine when we've copied enough bytes to the output file.
-    // Each time through the loop, except the last time, we will copy BLOCK_SIZE number of bytes from
-    // our stored data to the file fp, then we will increment the offset into the file we are writing to.
-    // On the last iteration of the loop, instead of copying BLOCK_SIZE number of bytes we just copy
-    // how ever much is remaining ( copy_size % BLOCK_SIZE ).  If we just copied BLOCK_SIZE on the
-    // last iteration we'd end up with gibberish at the end of our file. 
-  while( copy_size > 0 )
-  { 
-    int block_index = inodes_list[filenum].blocks[block_count];
-    // reads the specific block from the inode to copy into the file
-    int num_bytes;
+  for(n = 0; n < count; n++)
+  {
+    char *token[MAX_NUM_ARGUMENTS];
+    char arg1[32], arg2[32];
+    memset(token, 0, sizeof(token));
 
-      // If the remaining number of bytes we need to copy is less than BLOCK_SIZE then
-      // only copy the amount that remains. If we copied BLOCK_SIZE number of bytes we'd
-      // end up with garbage at the end of the file.
-    if( copy_size < BLOCK_SIZE )
+    // draws the command from the mix
+    int pick = lrand48() % total_weight;
+    int op = 0;
+    while(pick >= weights[op])
     {
-      num_bytes = copy_size;
+      pick -= weights[op++];
     }
-    else 
+    long size = (long) exp(log((double) median) + normal());
+    if(size > max_size)
     {
-      num_bytes = BLOCK_SIZE;
+      size = max_size;
     }
 
-      // Write num_bytes number of bytes from our data array into our output file.
-    fwrite( blocks[block_index], num_bytes, 1, ofp ); 
-
-      // Reduce the amount of bytes remaining to copy, increase the offset into the file
-      // and increment the block_index to move us to the next data block.
-    copy_size -= BLOCK_SIZE;
-    offset    += BLOCK_SIZE;
-    block_count ++;
+    // keeps the generated workload valid for the simulated file system
+    if(op != 0 && op < 5 && live_count == 0)
+    {
+      op = 0;
+    }
+    if(op == 0 && (live_count == NUM_FILE || used + size > budget))
+    {
+      op = 4;
+    }
+    int victim = live_count > 0 ? lrand48() % live_count : 0;
+    if(op == 3 && sizes[victim] + append_size > max_size * 2)
+    {
+      op = 1;
+    }
 
-      // Since we've copied from the point pointed to by our current file pointer, increment
-      // offset number of bytes so we will be ready to copy to the next area of our output file.
-    fseek( ofp, offset, SEEK_SET );
+    token[0] = names[op];
+    if(op == 0)
+    {
+      snprintf(live[live_count], FILENAME_LEN, "wl_%05d.dat", next_id++);
+      write_host_file(live[live_count], size);
+      sizes[live_count] = size;
+      token[1] = live[live_count];
+      live_count++;
+      used += size;
+    }
+    else if(op == 1)
+    {
+      token[1] = live[victim];
+      token[2] = "/dev/null";
+    }
+    else if(op == 2)
+    {
+      long offset = sizes[victim] > 0 ? lrand48() % sizes[victim] : 0;
+      long length = sizes[victim] - offset < 65536 ? sizes[victim] - offset : 65536;
+      snprintf(arg1, sizeof(arg1), "%ld", offset);
+      snprintf(arg2, sizeof(arg2), "%ld", length);
+      token[1] = live[victim];
+      token[2] = arg1;
+      token[3] = arg2;
+    }
+    else if(op == 3)
+    {
+      token[1] = live[victim];
+      token[2] = "wl_append.dat";
+      sizes[victim] += append_size;
+      used += append_size;
+    }
+    else if(op == 4)
+    {
+      // the name is written before the slot is reused by the last live file
+      strcpy(arg1, live[victim]);
+      token[1] = arg1;
+      used -= sizes[victim];
+      live_count--;
+      strcpy(live[victim], live[live_count]);
+      sizes[victim] = sizes[live_count];
+    }
+    else if(op == 6)
+    {
+      snprintf(arg1, sizeof(arg1), "%ld..", median);
+      token[1] = "-size";
+      token[2] = arg1;
+      token[3] = "-sort";
+      token[4] = "size";
+      token[5] = "-limit";
+      token[6] = "10";
+    }
+    trace_write(fp, (uint64_t) now, 0, 0, token);
+    now += -log(1.0 - drand48()) * 1e6;
   }
-
-    // Close the output file, we're done. 
-  fclose( ofp );
+  fclose(fp);
+  return 0;
 }
 
- /* attrib is a void function has two parameters wwhere both of them are char pointer.
-  This function basically sets the asssigned atributes to a requested file if
-  it is present in the file system.
- */
-void attrib(char* attributes, char* filename)
+/*
+  tool_main is an int function for the tools of mfs, chosen by the first option:
+    -t <trace>                            records every command of the session
+    -r <trace> [-p] [-i <image>]          replays a trace, -p keeps the original pace
+    -g <trace> [-n count] [-s seed] [-m mix] [-z median size]   makes a workload
+  mfs-replay <trace> [-p] [-i <image>] is the same as mfs -r.
+*/
+int tool_main(int argc, char** argv)
 {
-  int filenum = file_searcher(filename);
-  if(filenum ==-1){
-    //checks if filename is in the file sys or not
-    printf("mfs> attrib: File not found\n");
-    return;
+  char * image = NULL;
+  char * mix = NULL;
+  int pacing = 0;
+  long count = 1000;
+  long seed = 1;
+  long median = 64 * 1024;
+  int i;
+  if(argc < 3)
+  {
+    fprintf(stderr, "usage: mfs -t <trace> | -r <trace> [-p] [-i image] | "
+      "-g <trace> [-n count] [-s seed] [-m mix] [-z median size]\n");
+    return 1;
   }
-  if(attributes[0] =='+')
+  for(i = 3; i < argc; i++)
   {
-    // sets the respective attributes according to the user input.
-    if(attributes[1]=='h'|| attributes[1]=='H')
+    char * value = i + 1 < argc ? argv[i + 1] : NULL;
+    if(strcmp(argv[i], "-p") == 0)
     {
-      // if +h is typed sets hidden attribute
-      inodes_list[dir[filenum].inode].attributes_h = 1; 
+      pacing = 1;
+      continue;
     }
-    else if(attributes[1]=='r'|| attributes[1]=='R')
+    if(value == NULL)
     {
-      // if +r is typed sets read only attribute
-      inodes_list[dir[filenum].inode].attributes_r = 1; 
+      fprintf(stderr, "mfs: %s needs a value\n", argv[i]);
+      return 1;
     }
-    else
+    if(strcmp(argv[i], "-i") == 0)
     {
-      printf("mfs> attrib: Unrecognized attribute.\n"); 
-    }     
-  }
-  else if(attributes[0]=='-')
-  {
-    // sets the respective attributes according to the user input.
-    if(attributes[1]=='h'|| attributes[1]=='H')
+      image = value;
+    }
+    else if(strcmp(argv[i], "-m") == 0)
     {
-      // if -h is typed removes hidden attribute
-      inodes_list[dir[filenum].inode].attributes_h = 0; 
+      mix = value;
     }
-    else if(attributes[1]=='r'|| attributes[1]=='R')
+    else if(strcmp(argv[i], "-n") == 0)
     {
-      // if -r is typed removes read only attribute
-      inodes_list[dir[filenum].inode].attributes_r = 0; 
+      count = parse_offset(value);
+    }
+    else if(strcmp(argv[i], "-s") == 0)
+    {
+      seed = parse_offset(value);
+    }
+    else if(strcmp(argv[i], "-z") == 0)
+    {
+      median = parse_size(value);
     }
     else
     {
-      printf("mfs> attrib: Unrecognized attribute.\n"); 
+      fprintf(stderr, "mfs: unknown option %s\n", argv[i]);
+      return 1;
     }
+    i++;
   }
-  else
+  if(count < 0 || seed < 0 || median <= 0)
   {
-    printf("mfs> attrib: Unrecognized operation.\n");
-    return;
+    fprintf(stderr, "mfs: invalid number\n");
+    return 1;
   }
-
+  if(strcmp(argv[1], "-r") == 0)
+  {
+    return replay(argv[2], image, pacing);
+  }
+  if(strcmp(argv[1], "-g") == 0)
+  {
+    return generate(argv[2], count, seed, mix, median);
+  }
+  if(strcmp(argv[1], "-t") == 0)
+  {
+    trace("start", argv[2]);
+    return trace_file == NULL;
+  }
+  fprintf(stderr, "mfs: unknown option %s\n", argv[1]);
+  return 1;
 }
 
-int main()
+int main(int argc, char** argv)
 {
   // declares the directory list to the first block  
   dir = (Directory_Entry*) &blocks[0];
@@ -678,17 +3911,86 @@ int main()
   inodes_list = (Inode *) &blocks[7];
   
   // declares the list of free blocks to the sixth block 
-  free_block_list = (uint8_t*) &blocks[5];
+  free_block_list = (uint8_t*) &blocks[FREE_BLOCK_LIST_INDEX];
 
   // declares the list of free inodes to the seventh block
   free_inode_list = (uint8_t*) &blocks[6];
 
+  // declares the share counts of the data blocks to the third block
+  block_refs = (uint8_t*) &blocks[BLOCK_REFS_INDEX];
+
+  // declares the share counts of the inodes and the snapshot table to the fourth block
+  inode_refs = (uint8_t*) &blocks[SNAPSHOT_TABLE_INDEX];
+  snapshots = (Snapshot*) &blocks[SNAPSHOT_TABLE_INDEX][NUM_FILE];
+
+  // declares the superblock to the fifth block
+  superblock = (Superblock*) &blocks[SUPERBLOCK_INDEX];
+
   
   // initializes all the inode lists, dir lists and free list for inodes and blocks.
   initialized();
 
+  // MFS_DIRECT=1 turns direct I/O on from the start, e.g. for a single command
+  if(getenv("MFS_DIRECT") != NULL && strcmp(getenv("MFS_DIRECT"), "1") == 0)
+  {
+    direct_io = 1;
+  }
+
   int i;
 
+  // runs as mfs-replay, or runs the tool asked by the first option. Recording a
+  // trace goes on into the interactive session below.
+  char * program = strrchr(argv[0], '/');
+  program = program == NULL ? argv[0] : program + 1;
+  if(strcmp(program, "mfs-replay") == 0)
+  {
+    char * replay_argv[MAX_NUM_ARGUMENTS + 2] = { argv[0], "-r" };
+    for(i = 1; i < argc && i <= MAX_NUM_ARGUMENTS; i++)
+    {
+      replay_argv[i + 1] = argv[i];
+    }
+    return tool_main(i + 1, replay_argv);
+  }
+  if(argc > 1 && argv[1][0] == '-')
+  {
+    int status = tool_main(argc, argv);
+    if(status != 0 || strcmp(argv[1], "-t") != 0)
+    {
+      return status;
+    }
+  }
+
+  // runs a single command on an image when one is given on the command line,
+  // e.g. mfs disk.img put - backup.tar, so data can be piped in.
+  else if(argc > 2)
+  {
+    char *token[MAX_NUM_ARGUMENTS];
+    memset(token, 0, sizeof(token));
+    for(i = 2; i < argc && i - 2 < MAX_NUM_ARGUMENTS; i++)
+    {
+      token[i - 2] = argv[i];
+    }
+    batch_mode = 1;
+    // createfs and convert work on the image itself instead of opening it
+    if(strcmp(token[0], "createfs") == 0 || strcmp(token[0], "convert") == 0)
+    {
+      if(token[1] == NULL)
+      {
+        token[1] = argv[1];
+      }
+      execute(token);
+      return 0;
+    }
+    fs_open(argv[1]);
+    if(file_d == NULL)
+    {
+      return 1;
+    }
+    dispatch(token);
+    fs_close();
+    return 0;
+  }
+
   char * cmd_str = (char*) malloc( MAX_COMMAND_SIZE );
 
   while( 1 )
@@ -705,6 +4007,7 @@ int main()
 
     /* Parse input */
     char *token[MAX_NUM_ARGUMENTS];
+    memset(token, 0, sizeof(token));
 
     int   token_count = 0;                                 
 
@@ -733,64 +4036,20 @@ int main()
     // After tokenization of the command input the token is compared to check for their 
     // respective functionality in the program.
 
-    if(strcmp(token[0],"quit")==0 || strcmp(token[0],"exit")==0 )
+    if(token[0] != NULL && (strcmp(token[0],"quit")==0 || strcmp(token[0],"exit")==0))
     {
       // quits the program
       free( working_root );
       //checks if file is closed or not.
       // if fs is not closed it closes it first before exiting...
       if(file_d!= NULL) fs_close();
+      if(trace_file != NULL) fclose(trace_file);
       exit(0);
     }
-    else if(strcmp(token[0],"put")==0)
-    {
-      // puts a file form the current working directory into the file sys.
-      put(token[1]);
-    }
-    else if(strcmp(token[0],"get")==0)
-    {
-      // gets the file from the file sys and adds it to the working directory.
-      get(token[1],token[2]);
-    }
-    else if(strcmp(token[0],"del")==0)
-    {
-      // deletes a file from the file system
-      del(token[1]);
-    }
-    else if(strcmp(token[0],"list")==0)
-    {
-      // list all the files in the file system.
-      list(token[1]);
-    }
-    else if(strcmp(token[0],"df")==0)
-    { 
-      // dislplays the available free space in the file system.
-      df();
-    }
-    else if(strcmp(token[0],"open")==0)
-    {
-      // opens a requested file system if possible
-      open(token[1]);
-    }
-    else if(strcmp(token[0],"close")==0)  
-    {
-      // closes a open file system
-      fs_close();
-    }
-    else if(strcmp(token[0],"createfs")==0) 
-    {
-      // creates a empty file system with the given name
-      create_fs(token[1]);
-    }
-    else if(strcmp(token[0],"attrib")==0)
-    {
-      // sets the attribute of a file present in the file system
-      attrib(token[1], token[2]);
-    }
     else
     {
-      printf("mfs> Command not found. Try Again!!!\n");
-    } 
+      dispatch(token);
+    }
     free( working_root );
   }
   return 0;